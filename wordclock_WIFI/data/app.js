@@ -32,6 +32,8 @@ const blueValue = document.getElementById("blue-value");
 
 const languageButtons = document.querySelectorAll('input[name="language"]');
 const prefixModeButtons = document.querySelectorAll('input[name="prefixMode"]');
+const syncModeButtons = document.querySelectorAll('input[name="syncMode"]');
+const animationModeButtons = document.querySelectorAll('input[name="animationMode"]');
 const transitionButtons = document.querySelectorAll(".btn-transition");
 
 const brightnessSlider = document.getElementById("brightness-slider");
@@ -44,11 +46,25 @@ const transitionSpeedSlider = document.getElementById(
 const transitionSpeedValue = document.getElementById("transition-speed-value");
 
 const powerToggle = document.getElementById("power-toggle");
+const powerBudgetSlider = document.getElementById("power-budget-slider");
+const powerBudgetValue = document.getElementById("power-budget-value");
+const powerEstimate = document.getElementById("power-estimate");
 
 const colorModeToggle = document.getElementById("color-mode-toggle");
 const colorPickerSection = document.getElementById("color-picker-section");
 const colorSlidersSection = document.getElementById("color-sliders-section");
 
+// Live mirror of the LED matrix
+const mirror = document.getElementById("mirror");
+
+// Display schedule editor
+const scheduleRules = document.getElementById("schedule-rules");
+const scheduleTemplate = document.getElementById("schedule-rule-template");
+const scheduleAddBtn = document.getElementById("schedule-add-btn");
+const scheduleSaveBtn = document.getElementById("schedule-save-btn");
+const MAX_SCHEDULE_RULES = 8;
+let scheduleDirty = false; // unsaved edits are not overwritten by settings broadcasts
+
 // WiFi reset button
 const resetWifiBtn = document.getElementById("reset-wifi-btn");
 
@@ -63,7 +79,10 @@ let currentState = {
   superBright: false,
   prefixMode: 0,
   transition: 0,
-  transitionSpeed: 2
+  transitionSpeed: 2,
+  syncMode: 0,
+  powerBudget: 800,
+  colorMode: 0
 };
 
 // Color synchronization between picker and sliders
@@ -151,6 +170,16 @@ prefixModeButtons.forEach((button) => {
   button.addEventListener("change", sendUpdateRequest);
 });
 
+// Add real-time update listeners for animation mode change
+animationModeButtons.forEach((button) => {
+  button.addEventListener("change", sendUpdateRequest);
+});
+
+// Add real-time update listeners for sync mode change
+syncModeButtons.forEach((button) => {
+  button.addEventListener("change", sendUpdateRequest);
+});
+
 // Add click listeners for transition buttons - always send update
 let currentTransition = 0;
 transitionButtons.forEach((button) => {
@@ -172,11 +201,29 @@ transitionButtons.forEach((button) => {
 // Power toggle event listener
 powerToggle.addEventListener("change", sendUpdateRequest);
 
+powerBudgetSlider.addEventListener("input", () => {
+  powerBudgetValue.textContent = powerBudgetSlider.value + " mA";
+});
+
+powerBudgetSlider.addEventListener("change", () => {
+  sendUpdateRequest();
+});
+
 // Color mode toggle event listener
 colorModeToggle.addEventListener("change", () => {
   setColorMode(colorModeToggle.checked);
 });
 
+// Schedule editor event listeners
+scheduleAddBtn.addEventListener("click", () => {
+  if (scheduleRules.children.length >= MAX_SCHEDULE_RULES) return;
+  addScheduleRule({ days: 127, minute: 22 * 60, brightness: percentageToBrightness(20) });
+  scheduleDirty = true;
+});
+scheduleSaveBtn.addEventListener("click", sendSchedule);
+scheduleRules.addEventListener("input", () => (scheduleDirty = true));
+scheduleRules.addEventListener("change", () => (scheduleDirty = true));
+
 // WiFi reset button event listener
 resetWifiBtn.addEventListener("click", resetWiFiSettings);
 
@@ -187,6 +234,7 @@ document.addEventListener("DOMContentLoaded", () => {
 
   onLoad();
   setupEventSource();
+  setupFrameSocket();
 });
 
 function updateUI(data) {
@@ -198,6 +246,11 @@ function updateUI(data) {
   updatePrefixMode(data.prefixMode);
   updateTransition(data.transition);
   updateTransitionSpeed(data.transitionSpeed);
+  updateSyncMode(data.syncMode);
+  updatePowerBudget(data.powerBudget);
+  updatePowerEstimate(data.powerMa);
+  updateAnimationMode(data.colorMode);
+  updateSchedule(data.schedule);
 
   // Update current state
   currentState = {
@@ -210,7 +263,10 @@ function updateUI(data) {
     superBright: data.superBright,
     prefixMode: data.prefixMode,
     transition: data.transition,
-    transitionSpeed: data.transitionSpeed
+    transitionSpeed: data.transitionSpeed,
+    syncMode: data.syncMode,
+    powerBudget: data.powerBudget,
+    colorMode: data.colorMode
   };
 }
 
@@ -227,6 +283,7 @@ function updateLanguage(language) {
       button.checked = true;
     }
   });
+  buildMirror(language);
 }
 
 function updateBrightness(brightness) {
@@ -241,6 +298,112 @@ function updatePowerToggle(enabled) {
   powerToggle.checked = enabled !== undefined ? enabled : true;
 }
 
+function updatePowerBudget(powerBudget) {
+  const budget = powerBudget !== undefined ? powerBudget : 800;
+  powerBudgetSlider.value = budget;
+  powerBudgetValue.textContent = budget + " mA";
+}
+
+// Only /status reports the estimate, settings broadcasts leave it untouched
+function updatePowerEstimate(powerMa) {
+  if (powerMa !== undefined) {
+    powerEstimate.textContent = "Estimated draw: " + powerMa + " mA";
+  }
+}
+
+function updateSchedule(schedule) {
+  if (scheduleDirty || schedule === undefined) return;
+  scheduleRules.innerHTML = "";
+  schedule.forEach(addScheduleRule);
+}
+
+function addScheduleRule(rule) {
+  const element = scheduleTemplate.content.firstElementChild.cloneNode(true);
+  const hours = Math.floor(rule.minute / 60);
+  const minutes = rule.minute % 60;
+  element.querySelector(".schedule-time").value =
+    String(hours).padStart(2, "0") + ":" + String(minutes).padStart(2, "0");
+  element.querySelectorAll("[data-day]").forEach((day) => {
+    day.checked = (rule.days & (1 << parseInt(day.dataset.day))) !== 0;
+  });
+
+  if (rule.brightness !== undefined) {
+    element.querySelector(".schedule-use-brightness").checked = true;
+    element.querySelector(".schedule-brightness").value = brightnessToPercentage(rule.brightness);
+  }
+  if (rule.red !== undefined) {
+    element.querySelector(".schedule-use-color").checked = true;
+    element.querySelector(".schedule-color").value =
+      "#" + [rule.red, rule.green, rule.blue].map((c) => c.toString(16).padStart(2, "0")).join("");
+  }
+  if (rule.enabled !== undefined) {
+    element.querySelector(".schedule-use-power").checked = true;
+    element.querySelector(".schedule-power").value = rule.enabled ? "1" : "0";
+  }
+  if (rule.transition !== undefined) {
+    element.querySelector(".schedule-use-transition").checked = true;
+    element.querySelector(".schedule-transition").value = rule.transition;
+  }
+
+  element.querySelector(".schedule-remove").addEventListener("click", () => {
+    element.remove();
+    scheduleDirty = true;
+  });
+  scheduleRules.appendChild(element);
+}
+
+// Rules without a day or without anything to change are dropped by the clock
+function getSchedule() {
+  return Array.from(scheduleRules.children).map((element) => {
+    const [hours, minutes] = element.querySelector(".schedule-time").value.split(":");
+    const rule = { days: 0, minute: parseInt(hours) * 60 + parseInt(minutes) };
+    element.querySelectorAll("[data-day]").forEach((day) => {
+      if (day.checked) rule.days |= 1 << parseInt(day.dataset.day);
+    });
+
+    if (element.querySelector(".schedule-use-brightness").checked) {
+      rule.brightness = percentageToBrightness(parseInt(element.querySelector(".schedule-brightness").value));
+    }
+    if (element.querySelector(".schedule-use-color").checked) {
+      const hex = element.querySelector(".schedule-color").value;
+      rule.red = parseInt(hex.substr(1, 2), 16);
+      rule.green = parseInt(hex.substr(3, 2), 16);
+      rule.blue = parseInt(hex.substr(5, 2), 16);
+    }
+    if (element.querySelector(".schedule-use-power").checked) {
+      rule.enabled = element.querySelector(".schedule-power").value === "1";
+    }
+    if (element.querySelector(".schedule-use-transition").checked) {
+      rule.transition = parseInt(element.querySelector(".schedule-transition").value);
+    }
+    return rule;
+  });
+}
+
+function sendSchedule() {
+  const body = { schedule: getSchedule() };
+
+  fetch("/update", {
+    method: "POST",
+    headers: {
+      "Content-Type": "application/json"
+    },
+    body: JSON.stringify(body)
+  })
+    .then((response) => {
+      if (!response.ok) {
+        throw new Error("Network response was not ok");
+      }
+      console.log("Schedule updated successfully");
+      console.log(body);
+      scheduleDirty = false;
+      onLoad(); // Show the rules as the clock accepted them
+    })
+    .catch((error) => {
+      console.error("Error sending schedule:", error);
+    });
+}
+
 function updateSuperBright(superBright) {
   superBrightToggle.checked = superBright !== undefined ? superBright : false;
 }
@@ -254,6 +417,21 @@ function updatePrefixMode(prefixMode) {
   });
 }
 
+// Animated colour modes, the firmware calls them colorMode
+function updateAnimationMode(animationMode) {
+  const modeValue = animationMode !== undefined ? animationMode : 0; // Default to static
+  animationModeButtons.forEach((button) => {
+    button.checked = parseInt(button.value) === modeValue;
+  });
+}
+
+function updateSyncMode(syncMode) {
+  const syncValue = syncMode !== undefined ? syncMode : 0; // Default to off
+  syncModeButtons.forEach((button) => {
+    button.checked = parseInt(button.value) === syncValue;
+  });
+}
+
 function updateTransition(transition) {
   const transitionValue = transition !== undefined ? transition : 0; // Default to none
   currentTransition = transitionValue;
@@ -334,6 +512,26 @@ function getSelectedPrefixMode() {
   return selectedPrefixMode;
 }
 
+function getSelectedAnimationMode() {
+  let selectedAnimationMode = 0; // Default to static
+  animationModeButtons.forEach((button) => {
+    if (button.checked) {
+      selectedAnimationMode = parseInt(button.value);
+    }
+  });
+  return selectedAnimationMode;
+}
+
+function getSelectedSyncMode() {
+  let selectedSyncMode = 0; // Default to off
+  syncModeButtons.forEach((button) => {
+    if (button.checked) {
+      selectedSyncMode = parseInt(button.value);
+    }
+  });
+  return selectedSyncMode;
+}
+
 function getSelectedTransition() {
   return currentTransition;
 }
@@ -397,6 +595,9 @@ function sendUpdateRequest(forcePreview = false) {
   const prefixMode = getSelectedPrefixMode();
   const transition = getSelectedTransition();
   const transitionSpeed = getSelectedTransitionSpeed();
+  const syncMode = getSelectedSyncMode();
+  const powerBudget = parseInt(powerBudgetSlider.value);
+  const animationMode = getSelectedAnimationMode();
 
   // Build request body with only changed values
   const body = {};
@@ -413,6 +614,9 @@ function sendUpdateRequest(forcePreview = false) {
   const transitionChanged = transition !== currentState.transition;
   if (transitionChanged) body.transition = transition;
   if (transitionSpeed !== currentState.transitionSpeed) body.transitionSpeed = transitionSpeed;
+  if (syncMode !== currentState.syncMode) body.syncMode = syncMode;
+  if (powerBudget !== currentState.powerBudget) body.powerBudget = powerBudget;
+  if (animationMode !== currentState.colorMode) body.colorMode = animationMode;
 
   // Add forcePreview flag ONLY if explicitly requested (clicking transition button)
   // Don't add it when other settings change
@@ -449,6 +653,168 @@ function sendUpdateRequest(forcePreview = false) {
     });
 }
 
+// Live mirror
+const NUM_LEDS = 114;
+const FRAME_KEY = 1;
+const FRAME_DELTA = 2;
+
+const MIRROR_LAYOUTS = {
+  dialekt: [
+    "HESCEISCHOS",
+    "FÜNFZWANZIG",
+    "VIERTELZEHN",
+    "FVORLNOCHNS",
+    "HALBHZWOANS",
+    "DREIVSECHSE",
+    "SIEBNEZNÜNE",
+    "FÜNFEOACHTE",
+    "VIERENZEHNE",
+    "ELFEIZWÖLFE"
+  ],
+  deutsch: [
+    "HESCEISTHLS",
+    "FÜNFZWANZIG",
+    "VIERTELZEHN",
+    "FVORLNACHNS",
+    "HALBHZWEINS",
+    "DREIVSECHSE",
+    "SIEBENZNEUN",
+    "FÜNFENACHTE",
+    "VIERNZWÖLFE",
+    "ELFZEHNEUHR"
+  ]
+};
+
+let mirrorFrame = new Uint8Array(NUM_LEDS * 3);
+let mirrorCells = [];
+let mirrorLanguage = "";
+let mirrorDrawPending = false;
+let frameSocket = null;
+
+// The strip runs in a zigzag starting top left
+function ledIndex(row, col) {
+  return row * 11 + (row % 2 === 0 ? col : 10 - col);
+}
+
+function buildMirror(language) {
+  const layout = MIRROR_LAYOUTS[language] || MIRROR_LAYOUTS.dialekt;
+  if (language === mirrorLanguage) return;
+  mirrorLanguage = language;
+
+  mirror.innerHTML = "";
+  mirrorCells = new Array(NUM_LEDS);
+  layout.forEach((line, row) => {
+    [...line].forEach((letter, col) => {
+      const cell = document.createElement("span");
+      cell.className = "mirror-cell";
+      cell.textContent = letter;
+      mirror.appendChild(cell);
+      mirrorCells[ledIndex(row, col)] = cell;
+    });
+  });
+
+  // Minute LEDs 110-113 below the letters
+  const minutes = document.createElement("div");
+  minutes.className = "mirror-minutes";
+  for (let i = 110; i < NUM_LEDS; i++) {
+    const dot = document.createElement("span");
+    dot.className = "mirror-dot";
+    minutes.appendChild(dot);
+    mirrorCells[i] = dot;
+  }
+  mirror.appendChild(minutes);
+
+  drawMirror();
+}
+
+function drawMirror() {
+  mirrorDrawPending = false;
+  for (let i = 0; i < NUM_LEDS; i++) {
+    const cell = mirrorCells[i];
+    if (!cell) continue;
+
+    const r = mirrorFrame[i * 3];
+    const g = mirrorFrame[i * 3 + 1];
+    const b = mirrorFrame[i * 3 + 2];
+    const color = r || g || b ? `rgb(${r}, ${g}, ${b})` : "";
+    if (i >= 110) {
+      cell.style.background = color;
+    } else {
+      cell.style.color = color;
+    }
+  }
+}
+
+// Keyframes replace the frame, deltas are run-length encoded XOR against it
+function applyFrame(data) {
+  const bytes = new Uint8Array(data);
+  if (bytes.length < 2 || bytes[1] !== NUM_LEDS) return;
+
+  if (bytes[0] === FRAME_KEY) {
+    mirrorFrame.set(bytes.subarray(2, 2 + NUM_LEDS * 3));
+  } else if (bytes[0] === FRAME_DELTA) {
+    let i = 0;
+    let p = 2;
+    while (p < bytes.length && i < mirrorFrame.length) {
+      const token = bytes[p++];
+      if (token & 0x80) {
+        i += (token & 0x7f) + 1;
+      } else {
+        for (let n = 0; n <= token; n++) {
+          mirrorFrame[i++] ^= bytes[p++];
+        }
+      }
+    }
+  }
+
+  if (!mirrorDrawPending) {
+    mirrorDrawPending = true;
+    requestAnimationFrame(drawMirror);
+  }
+}
+
+function setupFrameSocket() {
+  buildMirror(getSelectedLanguage() || "dialekt");
+
+  // Only stream while the page is visible, the clock skips all work without viewers
+  document.addEventListener("visibilitychange", () => {
+    if (document.hidden) {
+      closeFrameSocket();
+    } else {
+      openFrameSocket();
+    }
+  });
+  openFrameSocket();
+}
+
+function openFrameSocket() {
+  if (frameSocket) return;
+
+  const socket = new WebSocket(`ws://${location.host}/frames`);
+  socket.binaryType = "arraybuffer";
+  frameSocket = socket;
+
+  socket.addEventListener("message", (event) => applyFrame(event.data));
+
+  socket.addEventListener("close", () => {
+    // Closed on purpose or already replaced
+    if (frameSocket !== socket) return;
+
+    frameSocket = null;
+    if (!document.hidden) {
+      console.log("Frame socket closed, will attempt to reconnect...");
+      setTimeout(openFrameSocket, 5000);
+    }
+  });
+}
+
+function closeFrameSocket() {
+  if (!frameSocket) return;
+  const socket = frameSocket;
+  frameSocket = null;
+  socket.close();
+}
+
 // WiFi reset function
 function resetWiFiSettings() {
   console.log("Reset WiFi button clicked");
@@ -0,0 +1,246 @@
+#include <string.h>
+#include "clockSync.h"
+
+namespace clockSync
+{
+    const uint8_t MAGIC_0 = 'W';
+    const uint8_t MAGIC_1 = 'C';
+    const uint8_t VERSION = 2;
+
+    // keep the last few exchanges, the one with the lowest round trip wins
+    const uint8_t NUM_SAMPLES = 8;
+
+    struct Sample
+    {
+        int64_t offset;
+        int64_t delay;
+    };
+
+    Sample samples[NUM_SAMPLES];
+    uint8_t numSamples = 0;
+    uint8_t nextSample = 0;
+    uint8_t bestSample = 0;
+    uint32_t pendingSequence = 0;  // request waiting for its response, 0 = none
+    uint32_t leaderEpoch = 0;
+    bool hasLeaderEpoch = false;
+
+    // ------------------------------------------------------------
+    // packet encoding (little endian, fixed size)
+
+    void putU32(uint8_t *buffer, uint32_t value)
+    {
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            buffer[i] = (value >> (8 * i)) & 0xFF;
+        }
+    }
+
+    void putI64(uint8_t *buffer, int64_t value)
+    {
+        uint64_t raw = (uint64_t)value;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            buffer[i] = (raw >> (8 * i)) & 0xFF;
+        }
+    }
+
+    uint32_t getU32(const uint8_t *buffer)
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            value |= (uint32_t)buffer[i] << (8 * i);
+        }
+        return value;
+    }
+
+    int64_t getI64(const uint8_t *buffer)
+    {
+        uint64_t raw = 0;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            raw |= (uint64_t)buffer[i] << (8 * i);
+        }
+        return (int64_t)raw;
+    }
+
+    size_t encodePacket(const Packet &packet, uint8_t *buffer, size_t length)
+    {
+        if (length < PACKET_SIZE)
+        {
+            return 0;
+        }
+
+        memset(buffer, 0, PACKET_SIZE);
+        buffer[0] = MAGIC_0;
+        buffer[1] = MAGIC_1;
+        buffer[2] = VERSION;
+        buffer[3] = packet.type;
+        putU32(buffer + 4, packet.sequence);
+        putI64(buffer + 8, packet.originate);
+        putI64(buffer + 16, packet.receive);
+        putI64(buffer + 24, packet.transmit);
+        putI64(buffer + 32, packet.transitionStart);
+        putU32(buffer + 40, packet.clockEpoch);
+        return PACKET_SIZE;
+    }
+
+    bool decodePacket(const uint8_t *buffer, size_t length, Packet &packet)
+    {
+        if (length < PACKET_SIZE || buffer[0] != MAGIC_0 || buffer[1] != MAGIC_1 || buffer[2] != VERSION)
+        {
+            return false;
+        }
+
+        packet.type = buffer[3];
+        if (packet.type < PACKET_ANNOUNCE || packet.type > PACKET_RESPONSE)
+        {
+            return false;
+        }
+
+        packet.sequence = getU32(buffer + 4);
+        packet.originate = getI64(buffer + 8);
+        packet.receive = getI64(buffer + 16);
+        packet.transmit = getI64(buffer + 24);
+        packet.transitionStart = getI64(buffer + 32);
+        packet.clockEpoch = getU32(buffer + 40);
+        return true;
+    }
+
+    int64_t nextMinuteStart(int64_t now)
+    {
+        const int64_t minute = 60000000LL;
+        return (now / minute + 1) * minute;
+    }
+
+    int64_t nextTransition(int64_t now, int64_t announced)
+    {
+        return announced > now ? announced : nextMinuteStart(now);
+    }
+
+    int64_t wakeDelay(int64_t now, int64_t announced, int64_t maxWait)
+    {
+        int64_t until = nextTransition(now, announced) - now;
+        if (until >= maxWait)
+        {
+            return maxWait;
+        }
+        return (until / 1000 + 1) * 1000;  // never wake just before the boundary
+    }
+
+    // ------------------------------------------------------------
+    // exchanges
+
+    void makeAnnounce(int64_t now, uint32_t clockEpoch, Packet &announce)
+    {
+        announce = Packet();
+        announce.type = PACKET_ANNOUNCE;
+        announce.transmit = now;
+        announce.transitionStart = nextMinuteStart(now);
+        announce.clockEpoch = clockEpoch;
+    }
+
+    void makeResponse(const Packet &request, int64_t received, int64_t transmit, uint32_t clockEpoch, Packet &response)
+    {
+        response = request;
+        response.type = PACKET_RESPONSE;
+        response.receive = received;
+        response.transmit = transmit;
+        response.transitionStart = nextMinuteStart(received);
+        response.clockEpoch = clockEpoch;
+    }
+
+    void makeRequest(uint32_t sequence, int64_t now, Packet &request)
+    {
+        request = Packet();
+        request.type = PACKET_REQUEST;
+        request.sequence = sequence;
+        request.originate = now;
+        pendingSequence = sequence;
+    }
+
+    bool acceptResponse(const Packet &response, int64_t received)
+    {
+        if (pendingSequence == 0 || response.sequence != pendingSequence)
+        {
+            return false;
+        }
+        pendingSequence = 0;
+
+        // samples taken before the leader stepped its clock are off by the step
+        if (hasLeaderEpoch && response.clockEpoch != leaderEpoch)
+        {
+            numSamples = 0;
+            nextSample = 0;
+            bestSample = 0;
+        }
+        leaderEpoch = response.clockEpoch;
+        hasLeaderEpoch = true;
+
+        addSample(response.originate, response.receive, response.transmit, received);
+        return true;
+    }
+
+    // ------------------------------------------------------------
+    // offset estimation
+
+    void resetEstimator()
+    {
+        numSamples = 0;
+        nextSample = 0;
+        bestSample = 0;
+        pendingSequence = 0;
+        hasLeaderEpoch = false;
+    }
+
+    void addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4)
+    {
+        // standard four timestamp exchange, see NTP
+        int64_t delay = (t4 - t1) - (t3 - t2);
+        if (delay < 0)
+        {
+            return;  // clock stepped during the exchange, discard
+        }
+
+        samples[nextSample].offset = ((t2 - t1) + (t3 - t4)) / 2;
+        samples[nextSample].delay = delay;
+        nextSample = (nextSample + 1) % NUM_SAMPLES;
+        if (numSamples < NUM_SAMPLES)
+        {
+            numSamples++;
+        }
+
+        // the exchange with the shortest round trip has the smallest asymmetry error
+        bestSample = 0;
+        for (uint8_t i = 1; i < numSamples; i++)
+        {
+            if (samples[i].delay < samples[bestSample].delay)
+            {
+                bestSample = i;
+            }
+        }
+    }
+
+    void shiftLocalClock(int64_t step)
+    {
+        for (uint8_t i = 0; i < numSamples; i++)
+        {
+            samples[i].offset -= step;
+        }
+    }
+
+    bool hasOffset()
+    {
+        return numSamples > 0;
+    }
+
+    int64_t offset()
+    {
+        return numSamples > 0 ? samples[bestSample].offset : 0;
+    }
+
+    int64_t roundTrip()
+    {
+        return numSamples > 0 ? samples[bestSample].delay : 0;
+    }
+}
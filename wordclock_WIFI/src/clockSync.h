@@ -0,0 +1,69 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Leader/follower minute synchronization between several clocks.
+// All timestamps are microseconds since the unix epoch (UTC).
+namespace clockSync
+{
+    // role of this clock in a multi-clock setup
+    enum Role
+    {
+        ROLE_OFF = 0,      // standalone, NTP only
+        ROLE_LEADER = 1,   // announces its time and the next transition start
+        ROLE_FOLLOWER = 2  // estimates its offset to the leader and flips with it
+    };
+
+    enum PacketType
+    {
+        PACKET_ANNOUNCE = 1,  // leader -> multicast group
+        PACKET_REQUEST = 2,   // follower -> leader
+        PACKET_RESPONSE = 3   // leader -> follower
+    };
+
+    const uint16_t PORT = 4210;
+    const size_t PACKET_SIZE = 44;
+
+    struct Packet
+    {
+        uint8_t type;
+        uint32_t sequence;
+        int64_t originate;        // t1: follower send time (follower clock)
+        int64_t receive;          // t2: leader receive time (leader clock)
+        int64_t transmit;         // t3: leader send time (leader clock)
+        int64_t transitionStart;  // next minute transition (leader clock)
+        uint32_t clockEpoch;      // bumped each time the leader steps its clock
+    };
+
+    size_t encodePacket(const Packet &packet, uint8_t *buffer, size_t length);
+    bool decodePacket(const uint8_t *buffer, size_t length, Packet &packet);
+
+    // returns the start of the minute following now
+    int64_t nextMinuteStart(int64_t now);
+
+    // start of the next minute transition on the display clock, announced is the leader's (0 if unknown)
+    int64_t nextTransition(int64_t now, int64_t announced);
+
+    // time to sleep, at most maxWait, so a loop wakes right after the next transition (rounded up to ms)
+    int64_t wakeDelay(int64_t now, int64_t announced, int64_t maxWait);
+
+    // leader side, transmit is taken right before the response is sent
+    void makeAnnounce(int64_t now, uint32_t clockEpoch, Packet &announce);
+    void makeResponse(const Packet &request, int64_t received, int64_t transmit, uint32_t clockEpoch, Packet &response);
+
+    // follower side, only the response to the last request is accepted
+    void makeRequest(uint32_t sequence, int64_t now, Packet &request);
+    bool acceptResponse(const Packet &response, int64_t received);  // false for late or duplicate responses
+
+    // offset estimation from timestamped exchanges (t4: follower receive time)
+    void resetEstimator();
+    void addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+    void shiftLocalClock(int64_t step);  // local clock was stepped by step, keeps the offset valid
+    bool hasOffset();
+    int64_t offset();     // leader clock - local clock
+    int64_t roundTrip();  // network delay of the sample the offset is taken from
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "colorModes.h"
+
+namespace colorModes
+{
+    // full saturation and value colour wheel and one sine period, built on first use
+    uint8_t hueLut[256][3];
+    uint8_t sineLut[256];
+    bool lutsReady = false;
+
+    void buildLuts()
+    {
+        for (uint16_t hue = 0; hue < 256; hue++)
+        {
+            uint16_t scaled = hue * 6;
+            uint8_t up = scaled & 0xFF;
+            uint8_t down = 255 - up;
+            uint8_t *rgb = hueLut[hue];
+
+            switch (scaled >> 8)
+            {
+            case 0:
+                rgb[0] = 255, rgb[1] = up, rgb[2] = 0;
+                break;
+            case 1:
+                rgb[0] = down, rgb[1] = 255, rgb[2] = 0;
+                break;
+            case 2:
+                rgb[0] = 0, rgb[1] = 255, rgb[2] = up;
+                break;
+            case 3:
+                rgb[0] = 0, rgb[1] = down, rgb[2] = 255;
+                break;
+            case 4:
+                rgb[0] = up, rgb[1] = 0, rgb[2] = 255;
+                break;
+            default:
+                rgb[0] = 255, rgb[1] = 0, rgb[2] = down;
+                break;
+            }
+
+            sineLut[hue] = 128 + (int8_t)(127.0 * sin(hue * TWO_PI / 256.0));
+        }
+        lutsReady = true;
+    }
+
+    void hsvToRgb(uint8_t hue, uint8_t sat, uint8_t val, uint8_t &red, uint8_t &green, uint8_t &blue)
+    {
+        if (!lutsReady)
+        {
+            buildLuts();
+        }
+
+        // desaturate towards white, then scale by value
+        const uint8_t *rgb = hueLut[hue];
+        uint8_t white = 255 - sat;
+        red = ((rgb[0] + (((255 - rgb[0]) * white) >> 8)) * (val + 1)) >> 8;
+        green = ((rgb[1] + (((255 - rgb[1]) * white) >> 8)) * (val + 1)) >> 8;
+        blue = ((rgb[2] + (((255 - rgb[2]) * white) >> 8)) * (val + 1)) >> 8;
+    }
+
+    uint8_t rgbToHue(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        uint8_t max = red > green ? (red > blue ? red : blue) : (green > blue ? green : blue);
+        uint8_t min = red < green ? (red < blue ? red : blue) : (green < blue ? green : blue);
+        int16_t delta = max - min;
+        if (delta == 0)
+        {
+            return 0;  // grey, any hue
+        }
+
+        int16_t hue;
+        if (max == red)
+        {
+            hue = 0 + (43 * (green - blue)) / delta;
+        }
+        else if (max == green)
+        {
+            hue = 85 + (43 * (blue - red)) / delta;
+        }
+        else
+        {
+            hue = 171 + (43 * (red - green)) / delta;
+        }
+        return (uint8_t)hue;
+    }
+
+    // column 0-10 of a LED, the strip runs in a zigzag and the minute dots sit below the centre
+    uint8_t ledColumn(uint8_t led)
+    {
+        if (led >= 110)
+        {
+            return 2 + (led - 110) * 2;
+        }
+        uint8_t row = led / 11;
+        uint8_t col = led % 11;
+        return (row % 2 == 0) ? col : 10 - col;
+    }
+
+    void render(uint8_t mode, Adafruit_NeoPixel *strip, const WordSpan *words, uint8_t numWords, uint32_t ms, uint8_t red, uint8_t green, uint8_t blue)
+    {
+        if (mode == MODE_STATIC || mode >= NUM_MODES)
+        {
+            return;  // words already carry the config colour
+        }
+        if (!lutsReady)
+        {
+            buildLuts();
+        }
+
+        uint8_t r = red, g = green, b = blue;
+        uint8_t baseHue = rgbToHue(red, green, blue);
+
+        // whole-frame colours are computed once, not per LED
+        if (mode == MODE_HUE_DRIFT)
+        {
+            hsvToRgb(ms / 235, 255, 255, r, g, b);  // one full cycle per minute
+        }
+        else if (mode == MODE_BREATHING)
+        {
+            uint16_t level = 40 + ((sineLut[(ms >> 4) & 0xFF] * 216) >> 8);  // ~4 s period, never fully dark
+            r = (red * level) >> 8;
+            g = (green * level) >> 8;
+            b = (blue * level) >> 8;
+        }
+
+        for (uint8_t w = 0; w < numWords; w++)
+        {
+            if (mode == MODE_PALETTE)
+            {
+                hsvToRgb(baseHue + w * 37 + (ms >> 9), 255, 255, r, g, b);
+            }
+
+            for (uint16_t led = words[w].start; led <= words[w].end; led++)
+            {
+                if (mode == MODE_RAINBOW)
+                {
+                    const uint8_t *rgb = hueLut[(uint8_t)(ledColumn(led) * 23 + (ms >> 4))];
+                    r = rgb[0], g = rgb[1], b = rgb[2];
+                }
+                strip->setPixelColor(led, r, g, b);
+            }
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef COLORMODES_H
+#define COLORMODES_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "matrixUtils.h"
+
+namespace colorModes
+{
+    enum ColorMode
+    {
+        MODE_STATIC = 0,     // config colour on every lit word
+        MODE_RAINBOW = 1,    // rainbow across columns, scrolling
+        MODE_HUE_DRIFT = 2,  // whole clock slowly cycles through all hues
+        MODE_PALETTE = 3,    // each word its own hue, spread around the config colour
+        MODE_BREATHING = 4,  // config colour slowly pulsing
+        NUM_MODES = 5
+    };
+
+    // fixed point HSV -> RGB, all values 0-255
+    void hsvToRgb(uint8_t hue, uint8_t sat, uint8_t val, uint8_t &red, uint8_t &green, uint8_t &blue);
+    uint8_t rgbToHue(uint8_t red, uint8_t green, uint8_t blue);
+
+    // recolours only the lit words for the animation time ms
+    void render(uint8_t mode, Adafruit_NeoPixel *strip, const WordSpan *words, uint8_t numWords, uint32_t ms, uint8_t red, uint8_t green, uint8_t blue);
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include "text.h"
+#include "schedule.h"
+
+// Transition animation types
+enum TransitionType {
+  TRANSITION_NONE = 0,    // No animation, instant change
+  TRANSITION_FADE = 1,    // Fade out old, fade in new
+  TRANSITION_WIPE = 2,    // Wipe from left to right
+  TRANSITION_SPARKLE = 3  // Random sparkle effect
+};
+
+// ES IST/ES ISCH display modes
+enum PrefixMode {
+  PREFIX_ALWAYS = 0,  // Always show ES IST/ES ISCH
+  PREFIX_RANDOM = 1,  // Randomly show or hide
+  PREFIX_OFF = 2      // Never show ES IST/ES ISCH
+};
+
+const uint8_t TRANSITION_SPEED_MAX = 4;  // 0=extra slow ... 4=very fast
+const uint16_t POWER_BUDGET_MIN = 200;   // mA, must stay above the idle draw of all LEDs
+const uint16_t POWER_BUDGET_MAX = 3000;  // mA
+
+struct Config {
+  uint8_t red;              // red component (0-255)
+  uint8_t green;            // green component (0-255)
+  uint8_t blue;             // blue component (0-255)
+  uint8_t brightness;       // brightness (1-255, mapped from 1-100% slider)
+  Text language;            // language
+  bool enabled;             // wordclock on/off state
+  uint8_t transition;       // transition animation type
+  uint8_t prefixMode;       // ES IST/ES ISCH display mode
+  uint8_t transitionSpeed;  // transition speed: 1=slow, 2=medium, 3=fast
+  bool superBright;         // superbright mode: false=5-80%, true=5-100%
+  uint8_t syncMode;         // multi-clock sync: 0=off, 1=leader, 2=follower
+  uint16_t powerBudget;     // LED current budget in mA
+  uint8_t colorMode;        // 0=static, 1=rainbow, 2=hue drift, 3=palette, 4=breathing
+  schedule::Rule rules[schedule::MAX_RULES];  // display schedule in local time
+  uint8_t numRules;                           // rules in use
+};
+
+#endif
@@ -244,7 +244,7 @@ namespace deutsch
         // Show minute dots (LEDs 110-113)
         for (uint8_t i = 0; i < (minutes % 5); i++)
         {
-            strip->setPixelColor(110 + i, strip->Color(red, green, blue));
+            turnLedsOn(110 + i, 110 + i, strip, red, green, blue);
         }
 
         if (currentTimeString) *currentTimeString += " + ";
@@ -0,0 +1,79 @@
+#include <string.h>
+#include "frameStream.h"
+
+namespace frameStream
+{
+    size_t encodeKeyframe(const uint8_t *rgb, uint16_t numLeds, uint8_t *out, size_t outLen)
+    {
+        size_t len = 2 + numLeds * 3;
+        if (numLeds > 255 || outLen < len)
+        {
+            return 0;
+        }
+
+        out[0] = FRAME_KEY;
+        out[1] = numLeds;
+        memcpy(out + 2, rgb, numLeds * 3);
+        return len;
+    }
+
+    size_t encodeDelta(const uint8_t *previous, const uint8_t *rgb, uint16_t numLeds, uint8_t *out, size_t outLen)
+    {
+        const size_t bytes = numLeds * 3;
+        const size_t keyLen = 2 + bytes;
+        if (numLeds > 255 || outLen < 2)
+        {
+            return 0;
+        }
+
+        out[0] = FRAME_DELTA;
+        out[1] = numLeds;
+        size_t pos = 2;
+        bool changed = false;
+
+        size_t i = 0;
+        while (i < bytes)
+        {
+            // run of unchanged bytes
+            size_t run = 0;
+            while (i + run < bytes && run < 128 && previous[i + run] == rgb[i + run])
+            {
+                run++;
+            }
+            if (run > 0)
+            {
+                // a trailing skip carries no information
+                if (i + run < bytes)
+                {
+                    if (pos + 1 > outLen || pos + 1 >= keyLen)
+                    {
+                        return 0;
+                    }
+                    out[pos++] = 0x80 | (run - 1);
+                }
+                i += run;
+                continue;
+            }
+
+            // run of changed bytes, a single equal byte does not end it
+            run = 0;
+            while (i + run < bytes && run < 128 && (previous[i + run] != rgb[i + run] || (i + run + 1 < bytes && previous[i + run + 1] != rgb[i + run + 1])))
+            {
+                run++;
+            }
+            if (pos + 1 + run > outLen || pos + 1 + run >= keyLen)
+            {
+                return 0;
+            }
+            out[pos++] = run - 1;
+            for (size_t j = 0; j < run; j++)
+            {
+                out[pos++] = previous[i + j] ^ rgb[i + j];
+            }
+            i += run;
+            changed = true;
+        }
+
+        return changed ? pos : 0;
+    }
+}
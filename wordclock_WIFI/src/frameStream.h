@@ -0,0 +1,31 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact framebuffer encoding for the live mirror in the web UI.
+//
+// keyframe: [FRAME_KEY][numLeds][r g b] * numLeds
+// delta:    [FRAME_DELTA][numLeds][tokens...] applied by XOR onto the previous frame
+//   token 0x80 | n: skip n + 1 unchanged bytes
+//   token n:        n + 1 literal XOR bytes follow
+namespace frameStream
+{
+    const uint8_t FRAME_KEY = 1;
+    const uint8_t FRAME_DELTA = 2;
+
+    // upper bound for an encoded frame of numLeds LEDs
+    constexpr size_t maxFrameSize(uint16_t numLeds)
+    {
+        return 2 + numLeds * 3 + (numLeds * 3) / 128 + 1;
+    }
+
+    // rgb holds numLeds * 3 bytes, returns the encoded length or 0 if out is too small
+    size_t encodeKeyframe(const uint8_t *rgb, uint16_t numLeds, uint8_t *out, size_t outLen);
+
+    // returns 0 if nothing changed or if a keyframe would not be larger
+    size_t encodeDelta(const uint8_t *previous, const uint8_t *rgb, uint16_t numLeds, uint8_t *out, size_t outLen);
+}
+
+#endif
@@ -2,6 +2,9 @@
 #include <Adafruit_NeoPixel.h>
 #include "matrixUtils.h"
 
+WordSpan litWords[MAX_WORDS];
+uint8_t numLitWords = 0;
+
 // determine if "es isch" / "es ist" is shown
 bool showEsIst(uint8_t minutes, uint8_t prefixMode)
 {
@@ -41,4 +44,23 @@ void turnLedsOn(uint16_t start, uint16_t end, Adafruit_NeoPixel* strip, uint8_t
     {
         strip->setPixelColor(i, strip->Color(red, green, blue));
     }
+
+    // remember the word so colour modes only touch lit LEDs
+    if (numLitWords < MAX_WORDS)
+    {
+        litWords[numLitWords].start = start;
+        litWords[numLitWords].end = end;
+        numLitWords++;
+    }
+}
+
+void clearWords()
+{
+    numLitWords = 0;
+}
+
+uint8_t getWords(const WordSpan** words)
+{
+    *words = litWords;
+    return numLitWords;
 }
\ No newline at end of file
@@ -4,7 +4,20 @@
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
 
+// LEDs of one lit word (or minute dot), inclusive
+struct WordSpan
+{
+    uint8_t start;
+    uint8_t end;
+};
+
+const uint8_t MAX_WORDS = 16;
+
 bool showEsIst(uint8_t minutes, uint8_t prefixMode);
 void turnLedsOn(uint16_t start, uint16_t end, Adafruit_NeoPixel* strip, uint8_t red, uint8_t green, uint8_t blue);
 
+// words turned on since the last clearWords(), in display order
+void clearWords();
+uint8_t getWords(const WordSpan** words);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "powerModel.h"
+
+namespace powerModel
+{
+    uint32_t estimateGRB(const uint8_t *pixels, uint16_t numLeds, const LedModel &model)
+    {
+        // word frames are mostly dark, so summing per channel first keeps this to adds
+        uint32_t sumRed = 0, sumGreen = 0, sumBlue = 0;
+        for (uint16_t i = 0; i < numLeds; i++)
+        {
+            const uint8_t *pixel = pixels + i * 3;
+            sumGreen += pixel[0];
+            sumRed += pixel[1];
+            sumBlue += pixel[2];
+        }
+
+        uint32_t active = (sumRed * model.red + sumGreen * model.green + sumBlue * model.blue + 254) / 255;
+        return active + (uint32_t)model.idle * numLeds;
+    }
+
+    uint16_t limitScale(uint32_t estimate, uint32_t idle, uint32_t budget)
+    {
+        if (estimate <= budget)
+        {
+            return 256;
+        }
+        if (budget <= idle)
+        {
+            return 0;  // not even a dark strip fits
+        }
+
+        uint32_t active = estimate - idle;
+        uint32_t allowed = budget - idle;
+        return (uint16_t)(((uint64_t)allowed * 256) / active);
+    }
+
+    uint16_t step(uint32_t estimate, uint32_t idle, uint32_t budget, uint16_t scale, uint16_t release)
+    {
+        // cutting at once keeps the budget, recovering gradually keeps limiting from showing as flicker
+        uint16_t target = limitScale(estimate, idle, budget);
+        if (target < scale)
+        {
+            return target;
+        }
+        return scale + release < target ? scale + release : target;
+    }
+
+    uint32_t scaledEstimate(uint32_t estimate, uint32_t idle, uint16_t scale)
+    {
+        if (estimate <= idle)
+        {
+            return estimate;
+        }
+        // rounded up like estimateGRB(), so this stays an upper bound of the scaled frame
+        return idle + (uint32_t)(((uint64_t)(estimate - idle) * scale + 255) / 256);
+    }
+
+    void scalePixels(uint8_t *pixels, size_t length, uint16_t scale)
+    {
+        if (scale >= 256)
+        {
+            return;
+        }
+        for (size_t i = 0; i < length; i++)
+        {
+            if (pixels[i])
+            {
+                pixels[i] = (pixels[i] * scale) >> 8;
+            }
+        }
+    }
+}
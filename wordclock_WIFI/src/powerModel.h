@@ -0,0 +1,34 @@
+#ifndef POWERMODEL_H
+#define POWERMODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Current estimation for WS2812B frames. Currents are in µA.
+namespace powerModel
+{
+    struct LedModel
+    {
+        uint16_t red;    // red channel at full scale
+        uint16_t green;  // green channel at full scale
+        uint16_t blue;   // blue channel at full scale
+        uint16_t idle;   // quiescent draw of one LED with all channels off
+    };
+
+    // pixels in strip wire order (GRB), brightness already applied
+    uint32_t estimateGRB(const uint8_t *pixels, uint16_t numLeds, const LedModel &model);
+
+    // scale (0-256) that keeps a frame drawing estimate within budget
+    uint16_t limitScale(uint32_t estimate, uint32_t idle, uint32_t budget);
+
+    // one frame of the limiter: cuts to the budget at once, eases back up by release (of 256) per frame
+    uint16_t step(uint32_t estimate, uint32_t idle, uint32_t budget, uint16_t scale, uint16_t release);
+
+    // worst case draw of a frame after scaling
+    uint32_t scaledEstimate(uint32_t estimate, uint32_t idle, uint16_t scale);
+
+    // scales every byte by scale / 256, rounding down so the budget holds
+    void scalePixels(uint8_t *pixels, size_t length, uint16_t scale);
+}
+
+#endif
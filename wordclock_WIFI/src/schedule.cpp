@@ -0,0 +1,197 @@
+#include <string.h>
+#include "schedule.h"
+
+namespace schedule
+{
+    const time_t SECONDS_PER_DAY = 86400;
+
+    static_assert(sizeof(Rule) == 10, "Rule is stored as raw bytes");
+
+    time_t floorDiv(time_t value, time_t divisor)
+    {
+        time_t quotient = value / divisor;
+        return (value % divisor < 0) ? quotient - 1 : quotient;
+    }
+
+    // 0 = Sunday, the epoch started on a Thursday
+    uint8_t weekday(time_t local)
+    {
+        time_t days = floorDiv(local, SECONDS_PER_DAY);
+        return (uint8_t)(((days + 4) % 7 + 7) % 7);
+    }
+
+    time_t utcOffset(time_t utc, ToLocal toLocal)
+    {
+        return toLocal(utc) - utc;
+    }
+
+    bool isValid(const Rule &rule)
+    {
+        return rule.days != 0 && (rule.days & ~ALL_DAYS) == 0 &&
+               rule.fields != 0 && (rule.fields & ~ALL_FIELDS) == 0 &&
+               rule.minute < MINUTES_PER_DAY &&
+               (!(rule.fields & FIELD_BRIGHTNESS) || rule.brightness > 0) &&
+               rule.enabled <= 1;
+    }
+
+    bool sameRules(const Rule *a, uint8_t numA, const Rule *b, uint8_t numB)
+    {
+        return numA == numB && memcmp(a, b, numA * sizeof(Rule)) == 0;
+    }
+
+    time_t localToUtc(time_t local, ToLocal toLocal)
+    {
+        // offsets a day before and after, DST changes are months apart
+        time_t offsetBefore = utcOffset(local - SECONDS_PER_DAY, toLocal);
+        time_t offsetAfter = utcOffset(local + SECONDS_PER_DAY, toLocal);
+        time_t before = local - offsetBefore;
+        time_t after = local - offsetAfter;
+        bool validBefore = toLocal(before) == local;
+        bool validAfter = toLocal(after) == local;
+
+        if (validBefore && validAfter)
+        {
+            return before < after ? before : after;  // repeated hour, first occurrence
+        }
+        if (validBefore)
+        {
+            return before;
+        }
+        if (validAfter)
+        {
+            return after;
+        }
+
+        // skipped hour, the change happens between the two candidates
+        time_t low = before < after ? before : after;
+        time_t high = before < after ? after : before;
+        time_t lowOffset = utcOffset(low, toLocal);
+        while (high - low > 1)
+        {
+            time_t middle = low + (high - low) / 2;
+            if (utcOffset(middle, toLocal) == lowOffset)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return high;
+    }
+
+    void compile(const Rule *rules, uint8_t numRules, time_t utc, ToLocal toLocal, Timetable &table)
+    {
+        time_t local = toLocal(utc);
+        time_t midnight = floorDiv(local, SECONDS_PER_DAY) * SECONDS_PER_DAY;
+        uint8_t today = weekday(midnight);
+
+        table.dayStart = localToUtc(midnight, toLocal);
+        table.dayEnd = localToUtc(midnight + SECONDS_PER_DAY, toLocal);
+        table.numPoints = 0;
+        table.numCarried = 0;
+        table.next = 0;
+
+        if (numRules > MAX_RULES)
+        {
+            numRules = MAX_RULES;
+        }
+
+        // minutes between the last run of each rule and midnight, 0 = not within the last week
+        int32_t age[MAX_RULES];
+        for (uint8_t i = 0; i < numRules; i++)
+        {
+            age[i] = 0;
+            for (uint8_t back = 1; back <= 7 && age[i] == 0; back++)
+            {
+                if (rules[i].days & (1 << ((today + 7 - back) % 7)))
+                {
+                    age[i] = back * (int32_t)MINUTES_PER_DAY - rules[i].minute;
+                }
+            }
+        }
+
+        // a rule carries in if it is the last one that set one of its fields, later rules win ties
+        bool carried[MAX_RULES];
+        for (uint8_t i = 0; i < numRules; i++)
+        {
+            carried[i] = false;
+        }
+        for (uint8_t field = 1; field & ALL_FIELDS; field <<= 1)
+        {
+            int8_t latest = -1;
+            for (uint8_t i = 0; i < numRules; i++)
+            {
+                if (age[i] > 0 && (rules[i].fields & field) && (latest < 0 || age[i] <= age[latest]))
+                {
+                    latest = i;
+                }
+            }
+            if (latest >= 0)
+            {
+                carried[latest] = true;
+            }
+        }
+
+        // sort key: carried rules by age (oldest first) before today's rules by minute
+        int32_t keys[MAX_POINTS];
+        for (uint8_t pass = 0; pass < 2; pass++)
+        {
+            for (uint8_t i = 0; i < numRules; i++)
+            {
+                int32_t key;
+                if (pass == 0 && carried[i])
+                {
+                    key = -age[i];
+                }
+                else if (pass == 1 && (rules[i].days & (1 << today)))
+                {
+                    key = rules[i].minute;
+                }
+                else
+                {
+                    continue;
+                }
+
+                // insertion sort, equal keys keep the rule order
+                uint8_t pos = table.numPoints++;
+                while (pos > 0 && keys[pos - 1] > key)
+                {
+                    keys[pos] = keys[pos - 1];
+                    table.points[pos] = table.points[pos - 1];
+                    pos--;
+                }
+                keys[pos] = key;
+                table.points[pos].rule = i;
+                table.points[pos].at = pass == 0 ? table.dayStart : localToUtc(midnight + key * 60, toLocal);
+            }
+            if (pass == 0)
+            {
+                table.numCarried = table.numPoints;
+            }
+        }
+    }
+
+    uint8_t due(const Rule *rules, uint8_t numRules, time_t utc, ToLocal toLocal, Timetable &table)
+    {
+        if (utc < table.dayStart || utc >= table.dayEnd)
+        {
+            // a missed point or a clock step back gets the carried points again
+            bool dayDone = table.next >= table.numPoints;
+            time_t previousEnd = table.dayEnd;
+            compile(rules, numRules, utc, toLocal, table);
+            if (dayDone && table.dayStart == previousEnd)
+            {
+                table.next = table.numCarried;
+            }
+        }
+
+        uint8_t first = table.next;
+        while (table.next < table.numPoints && table.points[table.next].at <= utc)
+        {
+            table.next++;
+        }
+        return first;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Display schedules, e.g. dimmer at night and off on weekend mornings.
+//
+// Rules are given in local wall time. Once per local day they are compiled into
+// a sorted timetable of UTC change points, so the display task only has to
+// compare the time with the next point.
+namespace schedule
+{
+    // settings a rule changes, unset fields are left alone
+    enum Field
+    {
+        FIELD_BRIGHTNESS = 1 << 0,
+        FIELD_COLOR = 1 << 1,
+        FIELD_POWER = 1 << 2,
+        FIELD_TRANSITION = 1 << 3,
+        ALL_FIELDS = (1 << 4) - 1
+    };
+
+    const uint8_t MAX_RULES = 8;
+    const uint8_t MAX_POINTS = 2 * MAX_RULES;  // each rule once carried in and once today
+    const uint8_t ALL_DAYS = 0x7F;
+    const uint16_t MINUTES_PER_DAY = 1440;
+
+    // stored as is in NVS, keep the layout free of padding
+    struct Rule
+    {
+        uint8_t days;       // bit 0 = Sunday ... bit 6 = Saturday
+        uint8_t fields;     // Field bits
+        uint16_t minute;    // local time of day, 0-1439
+        uint8_t brightness;
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+        uint8_t enabled;
+        uint8_t transition;
+    };
+
+    struct ChangePoint
+    {
+        time_t at;     // UTC
+        uint8_t rule;  // index into the rules the timetable was compiled from
+    };
+
+    struct Timetable
+    {
+        time_t dayStart;  // UTC start of the local day
+        time_t dayEnd;    // UTC start of the next local day
+        ChangePoint points[MAX_POINTS];
+        uint8_t numPoints;
+        uint8_t numCarried;  // leading points at dayStart: rules still in effect from earlier days
+        uint8_t next;        // first point not applied yet
+    };
+
+    // converts UTC to local time, e.g. Timezone::toLocal
+    typedef time_t (*ToLocal)(time_t utc);
+
+    bool isValid(const Rule &rule);
+    bool sameRules(const Rule *a, uint8_t numA, const Rule *b, uint8_t numB);
+
+    // first UTC time whose local time is local, the end of the gap if it is skipped by DST
+    time_t localToUtc(time_t local, ToLocal toLocal);
+
+    // compiles the local day containing utc, next points at the first change point
+    void compile(const Rule *rules, uint8_t numRules, time_t utc, ToLocal toLocal, Timetable &table);
+
+    // Called every display tick: recompiles once utc leaves the compiled day and moves
+    // next past the points due by utc. Returns the first of them, points [first, next)
+    // are to be applied now. Right after a finished day the carried points are skipped,
+    // the day before already applied them.
+    uint8_t due(const Rule *rules, uint8_t numRules, time_t utc, ToLocal toLocal, Timetable &table);
+
+    // UTC time of the next change point, dayEnd once the day is done
+    inline time_t nextChange(const Timetable &table)
+    {
+        return table.next < table.numPoints ? table.points[table.next].at : table.dayEnd;
+    }
+}
+
+#endif
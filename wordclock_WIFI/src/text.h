@@ -0,0 +1,14 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+// String type of the settings and the HTTP API: Arduino String on the device,
+// std::string on the host, both work with ArduinoJson
+#ifdef ARDUINO
+#include <Arduino.h>
+typedef String Text;
+#else
+#include <string>
+typedef std::string Text;
+#endif
+
+#endif
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <chrono>
+#endif
+
+namespace trace
+{
+    const char *const EVENT_NAMES[NUM_EVENTS] = { "render", "show", "transition", "mirror", "ntpSync", "httpStatus", "httpUpdate", "nvsWrite", "serial" };
+
+    struct Event
+    {
+        uint32_t timestamp;  // µs, wraps after ~71 minutes
+        uint8_t id;
+        uint8_t phase;       // 'B' or 'E'
+        uint8_t core;
+        uint8_t task;        // index into tasks, several tasks share a core
+        uint32_t sequence;   // claim index + 1 once written, 0 while being written
+    };
+
+    // Tasks are numbered in the order they first record an event, the export names them
+    struct Task
+    {
+        volatile bool named;
+        char name[16];
+    };
+
+    Event ring[RING_SIZE];
+    Task tasks[MAX_TASKS];
+    uint32_t head = 0;  // total events claimed, the ring holds the last RING_SIZE
+    uint8_t numTasks = 0;
+
+    // ------------------------------------------------------------
+    // recording
+
+    inline uint32_t now()
+    {
+#ifdef ARDUINO
+        return (uint32_t)esp_timer_get_time();
+#else
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    inline uint8_t core()
+    {
+#ifdef ARDUINO
+        return xPortGetCoreID();
+#else
+        return 0;
+#endif
+    }
+
+    inline void copyTaskName(char *name, size_t size)
+    {
+#ifdef ARDUINO
+        strncpy(name, pcTaskGetName(NULL), size - 1);
+#else
+        strncpy(name, "host", size - 1);
+#endif
+        name[size - 1] = '\0';
+    }
+
+    // ESP-IDF keeps thread locals in each task's TLS area, so this is per FreeRTOS task
+    thread_local uint8_t cachedTask = 0xFF;
+
+    // slot of the calling task, MAX_TASKS once the table is full
+    inline uint8_t taskIndex()
+    {
+        if (cachedTask == 0xFF)
+        {
+            uint8_t index = __atomic_fetch_add(&numTasks, 1, __ATOMIC_RELAXED);
+            if (index < MAX_TASKS)
+            {
+                copyTaskName(tasks[index].name, sizeof(tasks[index].name));
+                __atomic_store_n(&tasks[index].named, true, __ATOMIC_RELEASE);
+            }
+            else
+            {
+                __atomic_store_n(&numTasks, MAX_TASKS, __ATOMIC_RELAXED);  // keeps the counter from wrapping
+                index = MAX_TASKS;
+            }
+            cachedTask = index;
+        }
+        return cachedTask;
+    }
+
+    inline void record(uint8_t id, uint8_t phase)
+    {
+        // lock free across tasks and cores, a slot is claimed before it is written
+        // and its sequence tells a reader whether the write finished
+        uint32_t index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+        Event &event = ring[index & (RING_SIZE - 1)];
+        __atomic_store_n(&event.sequence, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        event.timestamp = now();
+        event.id = id;
+        event.phase = phase;
+        event.core = core();
+        event.task = taskIndex();
+        __atomic_store_n(&event.sequence, index + 1, __ATOMIC_RELEASE);
+    }
+
+    void begin(uint8_t id)
+    {
+        record(id, 'B');
+    }
+
+    void end(uint8_t id)
+    {
+        record(id, 'E');
+    }
+
+    // ------------------------------------------------------------
+    // export
+
+    Event snapshot[RING_SIZE];
+    uint16_t snapshotCount = 0;
+    bool exporting = false;  // only changed with atomics, HTTP and serial export race for it
+    uint32_t exportId = 0;
+
+    enum ExportStage
+    {
+        STAGE_HEADER,
+        STAGE_TASKS,
+        STAGE_EVENTS,
+        STAGE_FOOTER,
+        STAGE_DONE
+    };
+
+    ExportStage stage = STAGE_DONE;
+    uint16_t cursor = 0;
+    uint8_t taskCursor = 0;
+    uint32_t origin = 0;
+    const char *const HEADER =
+        "{\"traceEvents\":["
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"wordclock\"}}";
+    const char *const FOOTER = "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    char line[128];
+    const char *pending = line;  // piece of output being written
+    size_t lineLen = 0;
+    size_t linePos = 0;
+
+    uint32_t startExport()
+    {
+        bool idle = false;
+        if (!__atomic_compare_exchange_n(&exporting, &idle, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            return 0;
+        }
+        if (++exportId == 0)
+        {
+            exportId = 1;
+        }
+
+        // Recording goes on during the copy. An event is kept only if its slot
+        // holds the expected claim before and after the copy, events still being
+        // written or overwritten meanwhile are dropped.
+        uint32_t total = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        uint16_t count = total < RING_SIZE ? total : RING_SIZE;
+        snapshotCount = 0;
+        for (uint32_t index = total - count; index != total; index++)
+        {
+            const Event &event = ring[index & (RING_SIZE - 1)];
+            if (__atomic_load_n(&event.sequence, __ATOMIC_ACQUIRE) != index + 1)
+            {
+                continue;
+            }
+            snapshot[snapshotCount] = event;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&event.sequence, __ATOMIC_RELAXED) == index + 1)
+            {
+                snapshotCount++;
+            }
+        }
+
+        origin = snapshotCount > 0 ? snapshot[0].timestamp : 0;
+        stage = STAGE_HEADER;
+        taskCursor = 0;
+        cursor = 0;
+        lineLen = 0;
+        linePos = 0;
+        return exportId;
+    }
+
+    void cancelExport(uint32_t id)
+    {
+        if (__atomic_load_n(&exporting, __ATOMIC_ACQUIRE) && id == exportId)
+        {
+            stage = STAGE_DONE;
+            __atomic_store_n(&exporting, false, __ATOMIC_RELEASE);
+        }
+    }
+
+    // formats the next piece of output into line, false once everything was written
+    bool nextLine()
+    {
+        switch (stage)
+        {
+        case STAGE_HEADER:
+            pending = HEADER;
+            lineLen = strlen(HEADER);
+            stage = STAGE_TASKS;
+            return true;
+
+        case STAGE_TASKS:
+            while (taskCursor < MAX_TASKS)
+            {
+                const Task &task = tasks[taskCursor++];
+                if (!__atomic_load_n(&task.named, __ATOMIC_ACQUIRE))
+                {
+                    continue;
+                }
+                int len = snprintf(line, sizeof(line), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                                   taskCursor - 1, task.name);
+                pending = line;
+                lineLen = len < (int)sizeof(line) ? len : sizeof(line) - 1;
+                return true;
+            }
+            stage = STAGE_EVENTS;
+            // fall through
+
+        case STAGE_EVENTS:
+            if (cursor < snapshotCount)
+            {
+                const Event &event = snapshot[cursor++];
+                const char *name = event.id < NUM_EVENTS ? EVENT_NAMES[event.id] : "unknown";
+                int len = snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}",
+                                   name, event.phase, (unsigned long)(event.timestamp - origin), event.task, event.core);
+                pending = line;
+                lineLen = len < (int)sizeof(line) ? len : sizeof(line) - 1;
+                return true;
+            }
+            stage = STAGE_FOOTER;
+            // fall through
+
+        case STAGE_FOOTER:
+            pending = FOOTER;
+            lineLen = strlen(FOOTER);
+            stage = STAGE_DONE;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    size_t readExport(uint8_t *buffer, size_t maxLen)
+    {
+        size_t written = 0;
+        while (written < maxLen)
+        {
+            if (linePos >= lineLen)
+            {
+                if (!nextLine())
+                {
+                    break;
+                }
+                linePos = 0;
+            }
+
+            size_t chunk = lineLen - linePos;
+            if (chunk > maxLen - written)
+            {
+                chunk = maxLen - written;
+            }
+            memcpy(buffer + written, pending + linePos, chunk);
+            linePos += chunk;
+            written += chunk;
+        }
+
+        if (written == 0)
+        {
+            __atomic_store_n(&exporting, false, __ATOMIC_RELEASE);
+        }
+        return written;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-size in-RAM ring of begin/end events, exported in Chrome trace_event format
+// (load the JSON in chrome://tracing or ui.perfetto.dev).
+namespace trace
+{
+    enum EventId
+    {
+        EV_RENDER = 0,      // word layout and colour mode rendering
+        EV_SHOW = 1,        // strip.show(), one per frame or transition step
+        EV_TRANSITION = 2,  // whole minute transition or brightness fade
+        EV_MIRROR = 3,      // live mirror frame encoding
+        EV_NTP_SYNC = 4,
+        EV_HTTP_STATUS = 5,
+        EV_HTTP_UPDATE = 6,
+        EV_NVS_WRITE = 7,
+        EV_SERIAL = 8,      // serialPrint flush
+        NUM_EVENTS = 9
+    };
+
+    const uint16_t RING_SIZE = 512;  // power of two
+    const uint8_t MAX_TASKS = 16;    // later tasks share the unnamed tid MAX_TASKS
+
+    void begin(uint8_t id);
+    void end(uint8_t id);
+
+    // traces the enclosing block
+    class Scope
+    {
+    public:
+        explicit Scope(uint8_t id) : id(id) { begin(id); }
+        ~Scope() { end(id); }
+
+    private:
+        uint8_t id;
+    };
+
+    // Streams a snapshot of the ring as JSON, one export at a time.
+    // startExport() returns an export id, or 0 while another export is running.
+    uint32_t startExport();
+    size_t readExport(uint8_t *buffer, size_t maxLen);  // 0 once done, releases the export
+    void cancelExport(uint32_t exportId);               // releases an export that was not read to the end
+}
+
+#endif
@@ -0,0 +1,282 @@
+#include <string.h>
+#include <ArduinoJson.h>
+#include "webApi.h"
+#include "clockSync.h"
+
+namespace webApi
+{
+    const size_t RULE_MEMBERS = 8;
+    const size_t SCHEDULE_CAPACITY = JSON_ARRAY_SIZE(schedule::MAX_RULES) + schedule::MAX_RULES * JSON_OBJECT_SIZE(RULE_MEMBERS);
+    const size_t UPDATE_CAPACITY = JSON_OBJECT_SIZE(16) + SCHEDULE_CAPACITY + 512;  // keys and strings are copied out of the body
+    const size_t SETTINGS_MEMBERS = 14;
+    const size_t SETTINGS_CAPACITY = JSON_OBJECT_SIZE(SETTINGS_MEMBERS) + SCHEDULE_CAPACITY + 16;
+    const size_t STATUS_CAPACITY = JSON_OBJECT_SIZE(SETTINGS_MEMBERS + 5) + SCHEDULE_CAPACITY + JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(8) + 16;
+
+    template <typename T>
+    bool setIfChanged(T &field, const T &value)
+    {
+        if (field == value)
+        {
+            return false;
+        }
+        field = value;
+        return true;
+    }
+
+    long clampValue(JsonVariantConst value, long min, long max)
+    {
+        long v = value.as<long>();
+        return v < min ? min : (v > max ? max : v);
+    }
+
+    // missing fields are left out of the rule, returns false for rules to ignore
+    bool parseRule(JsonObjectConst object, schedule::Rule &rule)
+    {
+        memset(&rule, 0, sizeof(rule));
+        JsonVariantConst value;
+
+        long days = object["days"] | 0L;
+        long minute = object["minute"] | -1L;
+        if (days <= 0 || days > schedule::ALL_DAYS || minute < 0 || minute >= schedule::MINUTES_PER_DAY)
+            return false;
+        rule.days = days;
+        rule.minute = minute;
+
+        if (!(value = object["brightness"]).isNull())
+        {
+            rule.fields |= schedule::FIELD_BRIGHTNESS;
+            rule.brightness = clampValue(value, 1, 255);
+        }
+
+        if (!object["red"].isNull() || !object["green"].isNull() || !object["blue"].isNull())
+        {
+            rule.fields |= schedule::FIELD_COLOR;
+            rule.red = clampValue(object["red"], 0, 255);
+            rule.green = clampValue(object["green"], 0, 255);
+            rule.blue = clampValue(object["blue"], 0, 255);
+        }
+
+        if (!(value = object["enabled"]).isNull())
+        {
+            rule.fields |= schedule::FIELD_POWER;
+            rule.enabled = value.as<bool>();
+        }
+
+        if (!(value = object["transition"]).isNull())
+        {
+            long transition = value.as<long>();
+            if (transition >= TRANSITION_NONE && transition <= TRANSITION_SPARKLE)
+            {
+                rule.fields |= schedule::FIELD_TRANSITION;
+                rule.transition = transition;
+            }
+        }
+
+        return schedule::isValid(rule);
+    }
+
+    UpdateResult applyUpdate(const uint8_t *data, size_t len, Config &config, uint8_t numColorModes)
+    {
+        UpdateResult result = { false, nullptr, 0, false };
+
+        StaticJsonDocument<UPDATE_CAPACITY> doc;
+        DeserializationError error = deserializeJson(doc, data, len);
+        if (error || !doc.is<JsonObject>())
+        {
+            result.error = error ? error.c_str() : "Expected object";
+            return result;
+        }
+        result.valid = true;
+
+        JsonObjectConst body = doc.as<JsonObjectConst>();
+        JsonVariantConst value;
+
+        bool colorChanged = false;
+        if (!(value = body["red"]).isNull())
+            colorChanged |= setIfChanged(config.red, (uint8_t)clampValue(value, 0, 255));
+        if (!(value = body["green"]).isNull())
+            colorChanged |= setIfChanged(config.green, (uint8_t)clampValue(value, 0, 255));
+        if (!(value = body["blue"]).isNull())
+            colorChanged |= setIfChanged(config.blue, (uint8_t)clampValue(value, 0, 255));
+        if (colorChanged)
+            result.changes |= CHANGE_COLOR;
+
+        if (!(value = body["brightness"]).isNull() && setIfChanged(config.brightness, (uint8_t)clampValue(value, 1, 255)))
+            result.changes |= CHANGE_BRIGHTNESS;
+
+        if (!(value = body["language"]).isNull())
+        {
+            const char *language = value.as<const char *>();
+            if (language && (strcmp(language, "dialekt") == 0 || strcmp(language, "deutsch") == 0) && config.language != language)
+            {
+                config.language = language;
+                result.changes |= CHANGE_LANGUAGE;
+            }
+        }
+
+        if (!(value = body["enabled"]).isNull() && setIfChanged(config.enabled, value.as<bool>()))
+            result.changes |= CHANGE_ENABLED;
+
+        if (!(value = body["superBright"]).isNull() && setIfChanged(config.superBright, value.as<bool>()))
+            result.changes |= CHANGE_SUPERBRIGHT;
+
+        if (!(value = body["transition"]).isNull())
+        {
+            long transition = value.as<long>();
+            if (transition >= TRANSITION_NONE && transition <= TRANSITION_SPARKLE)
+            {
+                bool changed = setIfChanged(config.transition, (uint8_t)transition);
+                if (changed)
+                    result.changes |= CHANGE_TRANSITION;
+
+                // selecting a transition previews it, clicking the active one needs forcePreview
+                result.preview = changed || (body["forcePreview"] | false);
+            }
+        }
+
+        if (!(value = body["prefixMode"]).isNull())
+        {
+            long prefixMode = value.as<long>();
+            if (prefixMode >= PREFIX_ALWAYS && prefixMode <= PREFIX_OFF && setIfChanged(config.prefixMode, (uint8_t)prefixMode))
+                result.changes |= CHANGE_PREFIX_MODE;
+        }
+
+        if (!(value = body["transitionSpeed"]).isNull())
+        {
+            long speed = value.as<long>();
+            if (speed >= 0 && speed <= TRANSITION_SPEED_MAX && setIfChanged(config.transitionSpeed, (uint8_t)speed))
+                result.changes |= CHANGE_TRANSITION_SPEED;
+        }
+
+        if (!(value = body["syncMode"]).isNull())
+        {
+            long syncMode = value.as<long>();
+            if (syncMode >= clockSync::ROLE_OFF && syncMode <= clockSync::ROLE_FOLLOWER && setIfChanged(config.syncMode, (uint8_t)syncMode))
+                result.changes |= CHANGE_SYNC_MODE;
+        }
+
+        if (!(value = body["powerBudget"]).isNull() && setIfChanged(config.powerBudget, (uint16_t)clampValue(value, POWER_BUDGET_MIN, POWER_BUDGET_MAX)))
+            result.changes |= CHANGE_POWER_BUDGET;
+
+        if (!(value = body["colorMode"]).isNull())
+        {
+            long colorMode = value.as<long>();
+            if (colorMode >= 0 && colorMode < numColorModes && setIfChanged(config.colorMode, (uint8_t)colorMode))
+                result.changes |= CHANGE_COLOR_MODE;
+        }
+
+        // the schedule is always sent as a whole
+        JsonArrayConst rules = body["schedule"];
+        if (!rules.isNull())
+        {
+            schedule::Rule parsed[schedule::MAX_RULES];
+            uint8_t numParsed = 0;
+            for (JsonVariantConst rule : rules)
+            {
+                if (numParsed < schedule::MAX_RULES && rule.is<JsonObjectConst>() && parseRule(rule.as<JsonObjectConst>(), parsed[numParsed]))
+                    numParsed++;
+            }
+
+            if (!schedule::sameRules(config.rules, config.numRules, parsed, numParsed))
+            {
+                memcpy(config.rules, parsed, numParsed * sizeof(schedule::Rule));
+                config.numRules = numParsed;
+                result.changes |= CHANGE_SCHEDULE;
+            }
+        }
+
+        return result;
+    }
+
+    void fillSettings(const Config &config, JsonObject doc)
+    {
+        doc["red"] = config.red;
+        doc["green"] = config.green;
+        doc["blue"] = config.blue;
+        doc["brightness"] = config.brightness;
+        doc["language"] = config.language.c_str();  // the config outlives the document, no copy needed
+        doc["enabled"] = config.enabled;
+        doc["superBright"] = config.superBright;
+        doc["transition"] = config.transition;
+        doc["prefixMode"] = config.prefixMode;
+        doc["transitionSpeed"] = config.transitionSpeed;
+        doc["syncMode"] = config.syncMode;
+        doc["powerBudget"] = config.powerBudget;
+        doc["colorMode"] = config.colorMode;
+
+        JsonArray rules = doc.createNestedArray("schedule");
+        for (uint8_t i = 0; i < config.numRules; i++)
+        {
+            const schedule::Rule &rule = config.rules[i];
+            JsonObject object = rules.createNestedObject();
+            object["days"] = rule.days;
+            object["minute"] = rule.minute;
+            if (rule.fields & schedule::FIELD_BRIGHTNESS)
+                object["brightness"] = rule.brightness;
+            if (rule.fields & schedule::FIELD_COLOR)
+            {
+                object["red"] = rule.red;
+                object["green"] = rule.green;
+                object["blue"] = rule.blue;
+            }
+            if (rule.fields & schedule::FIELD_POWER)
+                object["enabled"] = (bool)rule.enabled;
+            if (rule.fields & schedule::FIELD_TRANSITION)
+                object["transition"] = rule.transition;
+        }
+    }
+
+    // serializes with a single allocation of the exact size
+    template <typename TDocument>
+    void serialize(const TDocument &doc, Text &out)
+    {
+        out = "";
+        out.reserve(measureJson(doc) + 1);
+        serializeJson(doc, out);
+    }
+
+    void writeSettings(const Config &config, Text &out)
+    {
+        StaticJsonDocument<SETTINGS_CAPACITY> doc;
+        fillSettings(config, doc.to<JsonObject>());
+        serialize(doc, out);
+    }
+
+    void writeStatus(const Config &config, const StatusInfo &info, Text &out)
+    {
+        StaticJsonDocument<STATUS_CAPACITY> doc;
+        JsonObject root = doc.to<JsonObject>();
+        fillSettings(config, root);
+        root["powerMa"] = info.powerMa;
+        JsonObject sync = root.createNestedObject("sync");
+        sync["role"] = info.syncRole;
+        if (info.hasSyncOffset)
+        {
+            sync["offsetUs"] = info.syncOffsetUs;
+            sync["roundTripUs"] = info.syncRoundTripUs;
+        }
+
+        if (info.hasScheduleChange)
+            root["nextScheduleChange"] = info.nextScheduleChange;
+
+        if (info.hasColorRender)
+        {
+            JsonObject render = root.createNestedObject("colorRender");
+            render["us"] = info.colorRenderUs;
+            render["maxUs"] = info.colorRenderMaxUs;
+            render["budgetUs"] = info.colorRenderBudgetUs;
+            render["frameUs"] = info.colorFrameUs;
+        }
+
+        JsonObject boot = root.createNestedObject("boot");
+        for (uint8_t i = 0; i < info.numBootPhases; i++)
+        {
+            if (info.bootPhaseMs[i] >= 0)
+            {
+                boot[info.bootPhaseNames[i]] = info.bootPhaseMs[i];
+            }
+        }
+
+        serialize(doc, out);
+    }
+}
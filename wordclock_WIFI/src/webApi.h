@@ -0,0 +1,66 @@
+#ifndef WEBAPI_H
+#define WEBAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "text.h"
+#include "config.h"
+
+// HTTP API logic without a transport: the webserver only moves the bytes
+namespace webApi
+{
+    // settings an update request actually changed
+    enum Change
+    {
+        CHANGE_COLOR = 1 << 0,
+        CHANGE_BRIGHTNESS = 1 << 1,
+        CHANGE_LANGUAGE = 1 << 2,
+        CHANGE_ENABLED = 1 << 3,
+        CHANGE_SUPERBRIGHT = 1 << 4,
+        CHANGE_TRANSITION = 1 << 5,
+        CHANGE_PREFIX_MODE = 1 << 6,
+        CHANGE_TRANSITION_SPEED = 1 << 7,
+        CHANGE_SYNC_MODE = 1 << 8,
+        CHANGE_POWER_BUDGET = 1 << 9,
+        CHANGE_COLOR_MODE = 1 << 10,
+        CHANGE_SCHEDULE = 1 << 11
+    };
+
+    struct UpdateResult
+    {
+        bool valid;         // body was valid JSON
+        const char *error;  // parser error if not
+        uint16_t changes;   // Change bits, values equal to the current ones are not counted
+        bool preview;       // transition preview requested
+    };
+
+    // runtime values /status reports next to the settings
+    struct StatusInfo
+    {
+        uint16_t powerMa;
+        const long *bootPhaseMs;  // -1 = not measured yet
+        const char *const *bootPhaseNames;
+        uint8_t numBootPhases;
+        bool hasColorRender;
+        unsigned long colorRenderUs;
+        unsigned long colorRenderMaxUs;
+        unsigned long colorRenderBudgetUs;
+        unsigned long colorFrameUs;
+        uint8_t syncRole;  // clockSync::Role actually running
+        bool hasSyncOffset;
+        long syncOffsetUs;     // leader clock - local clock
+        long syncRoundTripUs;  // of the exchange the offset is taken from
+        bool hasScheduleChange;
+        uint32_t nextScheduleChange;  // UTC
+    };
+
+    // parses, validates and applies an /update body, out of range values are clamped or ignored
+    // numColorModes: colour modes the renderer knows, keeps this module free of the LED code
+    UpdateResult applyUpdate(const uint8_t *data, size_t len, Config &config, uint8_t numColorModes);
+
+    // settings document, shared by /status and the settings event
+    void writeSettings(const Config &config, Text &out);
+    void writeStatus(const Config &config, const StatusInfo &info, Text &out);
+}
+
+#endif
@@ -0,0 +1,359 @@
+// Runs a leader and several followers as separate processes on localhost.
+// Every instance has its own clock, skewed against the others, and the
+// followers add a random return path delay to make the exchanges asymmetric.
+//
+// Each process runs a display loop that sleeps with clockSync::wakeDelay()
+// like displayTask() and records the true time its minute flips. Followers
+// find the leader from its ANNOUNCE packets and report how far their flip is
+// from the leader's. On the way the leader steps its clock (new clock epoch),
+// sends some responses late, and half of the followers step their own clock
+// the way an hourly NTP sync does.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "clockSync.h"
+
+namespace
+{
+    const int NUM_FOLLOWERS = 4;
+    const int64_t MINUTE_US = 60000000LL;
+    const int64_t FLIP_AFTER_US = 2500000;      // leader's minute boundary, from the start
+    const int64_t LEADER_STEP_AT_US = 2050000;  // leader clock step shortly before its flip, bumps its epoch
+    const int64_t LEADER_STEP_US = 300000;
+    const int64_t NTP_STEP_AT_US = 1600000;     // local clock step on even followers
+    const int64_t NTP_STEP_US = -730000;
+    const int REQUEST_INTERVAL_MS = 20;
+    const int ANNOUNCE_INTERVAL_MS = 100;
+    const int LATE_EVERY = 5;                   // every fifth response is sent again with the next one
+    const int MAX_ASYMMETRY_US = 3000;          // random extra delay on the way back
+    const int64_t FRAME_US = 100000;            // display loop period when nothing is animated
+    const int64_t FLIP_TARGET_US = 10000;       // followers must flip within 10 ms of the leader
+
+    int64_t trueMicros()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+    }
+
+    int openSocket()
+    {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) != 0)
+        {
+            perror("bind");
+            exit(2);
+        }
+        timeval timeout = {0, 200000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    sockaddr_in addressOf(int fd)
+    {
+        sockaddr_in address = {};
+        socklen_t len = sizeof(address);
+        getsockname(fd, (sockaddr *)&address, &len);
+        return address;
+    }
+
+    void sendPacket(int fd, const clockSync::Packet &packet, const sockaddr_in &to)
+    {
+        uint8_t buffer[clockSync::PACKET_SIZE];
+        size_t len = clockSync::encodePacket(packet, buffer, sizeof(buffer));
+        sendto(fd, buffer, len, 0, (const sockaddr *)&to, sizeof(to));
+    }
+
+    // an instance's clock: true time plus a skew that a clock step changes
+    struct Clock
+    {
+        std::atomic<int64_t> skew;
+        int64_t now() const { return trueMicros() + skew.load(); }
+    };
+
+    // displayTask(): sleep until the next frame or right after the transition,
+    // returns the true time the display clock shows a new minute
+    template <typename DisplayClock, typename Announced>
+    int64_t waitForFlip(DisplayClock displayNow, Announced announced)
+    {
+        int64_t lastMinute = displayNow() / MINUTE_US;
+        for (;;)
+        {
+            int64_t wake = clockSync::wakeDelay(displayNow(), announced(), FRAME_US);
+            std::this_thread::sleep_for(std::chrono::microseconds(wake));
+            if (displayNow() / MINUTE_US != lastMinute)
+                return trueMicros();
+        }
+    }
+
+    // announces and answers requests like handleSyncPacket() and updateClockSync() until killed
+    void serveFollowers(int fd, Clock &clock, std::atomic<uint32_t> &epoch, const sockaddr_in *followers, int64_t start)
+    {
+        uint8_t buffer[64];
+        int64_t nextAnnounce = 0;
+        int answered = 0;
+        clockSync::Packet late;
+        sockaddr_in lateTo = {};
+        bool hasLate = false;
+        bool stepped = false;
+        for (;;)
+        {
+            if (!stepped && trueMicros() - start >= LEADER_STEP_AT_US)
+            {
+                clock.skew += LEADER_STEP_US;
+                epoch++;
+                stepped = true;
+            }
+            if (trueMicros() >= nextAnnounce)
+            {
+                clockSync::Packet announce;
+                clockSync::makeAnnounce(clock.now(), epoch, announce);
+                for (int i = 0; i < NUM_FOLLOWERS; i++)
+                    sendPacket(fd, announce, followers[i]);
+                nextAnnounce = trueMicros() + ANNOUNCE_INTERVAL_MS * 1000;
+            }
+
+            sockaddr_in from = {};
+            socklen_t fromLen = sizeof(from);
+            ssize_t len = recvfrom(fd, buffer, sizeof(buffer), 0, (sockaddr *)&from, &fromLen);
+            int64_t received = clock.now();
+
+            clockSync::Packet in;
+            if (len <= 0 || !clockSync::decodePacket(buffer, len, in) || in.type != clockSync::PACKET_REQUEST)
+                continue;
+
+            if (hasLate)
+            {
+                sendPacket(fd, late, lateTo);  // arrives while the follower waits for a newer sequence
+                hasLate = false;
+            }
+
+            clockSync::Packet out;
+            clockSync::makeResponse(in, received, clock.now(), epoch, out);
+            sendPacket(fd, out, from);
+            if (++answered % LATE_EVERY == 0)
+            {
+                late = out;
+                lateTo = from;
+                hasLate = true;
+            }
+        }
+    }
+
+    struct Result
+    {
+        int64_t flipAt;       // true time the minute flipped
+        int64_t offsetError;  // display clock - leader clock at the flip
+        int64_t roundTrip;
+        int samples;
+        int rejected;         // late or duplicate responses dropped
+    };
+
+    Result runFollower(int fd, Clock &clock, int64_t leaderSkew, bool ntpStep, int64_t start, unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<int> asymmetry(0, MAX_ASYMMETRY_US);
+        std::mutex syncMux;  // the sketch's syncMux between the UDP and the display task
+        int64_t transitionStart = 0;
+        Result result = {0, 0, 0, 0, 0};
+
+        // discovery: the first ANNOUNCE tells where the leader is
+        sockaddr_in leader = {};
+        uint8_t buffer[64];
+        for (;;)
+        {
+            socklen_t leaderLen = sizeof(leader);
+            ssize_t len = recvfrom(fd, buffer, sizeof(buffer), 0, (sockaddr *)&leader, &leaderLen);
+            clockSync::Packet in;
+            if (len > 0 && clockSync::decodePacket(buffer, len, in) && in.type == clockSync::PACKET_ANNOUNCE)
+            {
+                transitionStart = in.transitionStart;
+                break;
+            }
+        }
+
+        clockSync::resetEstimator();
+        std::atomic<bool> running(true);
+        std::thread exchanges([&]() {
+            bool stepped = false;
+            for (uint32_t sequence = 1; running; sequence++)
+            {
+                if (ntpStep && !stepped && trueMicros() - start >= NTP_STEP_AT_US)
+                {
+                    std::lock_guard<std::mutex> lock(syncMux);
+                    clock.skew += NTP_STEP_US;
+                    clockSync::shiftLocalClock(NTP_STEP_US);
+                    stepped = true;
+                }
+
+                clockSync::Packet request;
+                {
+                    std::lock_guard<std::mutex> lock(syncMux);
+                    clockSync::makeRequest(sequence, clock.now(), request);
+                }
+                sendPacket(fd, request, leader);
+
+                // read until the response, announces and late answers may come first
+                int64_t deadline = trueMicros() + 200000;
+                while (trueMicros() < deadline)
+                {
+                    ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+                    if (len <= 0)
+                        break;
+                    clockSync::Packet in;
+                    if (!clockSync::decodePacket(buffer, len, in))
+                        continue;
+                    if (in.type == clockSync::PACKET_ANNOUNCE)
+                    {
+                        std::lock_guard<std::mutex> lock(syncMux);
+                        transitionStart = in.transitionStart;
+                        continue;
+                    }
+                    if (in.type != clockSync::PACKET_RESPONSE)
+                        continue;
+
+                    std::this_thread::sleep_for(std::chrono::microseconds(asymmetry(random)));
+                    std::lock_guard<std::mutex> lock(syncMux);
+                    if (clockSync::acceptResponse(in, clock.now()))
+                    {
+                        transitionStart = in.transitionStart;
+                        result.samples++;
+                        break;
+                    }
+                    result.rejected++;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(REQUEST_INTERVAL_MS));
+            }
+        });
+
+        auto displayNow = [&]() {
+            std::lock_guard<std::mutex> lock(syncMux);
+            return clock.now() + clockSync::offset();
+        };
+        auto announced = [&]() {
+            std::lock_guard<std::mutex> lock(syncMux);
+            return transitionStart;
+        };
+
+        // like the sketch before the first sample, but the flip must come from the leader's clock
+        while (!clockSync::hasOffset())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        result.flipAt = waitForFlip(displayNow, announced);
+
+        running = false;
+        exchanges.join();
+        std::lock_guard<std::mutex> lock(syncMux);
+        result.offsetError = clock.skew + clockSync::offset() - leaderSkew;
+        result.roundTrip = clockSync::roundTrip();
+        return result;
+    }
+}
+
+int main()
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int64_t> skews(-5000000, 5000000);
+
+    // the leader's minute ends FLIP_AFTER_US from now, minus its clock step
+    int64_t start = trueMicros();
+    int64_t leaderSkew = -((start + FLIP_AFTER_US) % MINUTE_US);
+    int64_t finalLeaderSkew = leaderSkew + LEADER_STEP_US;
+
+    int leaderFd = openSocket();
+    int followerFds[NUM_FOLLOWERS];
+    sockaddr_in followerAddresses[NUM_FOLLOWERS];
+    for (int i = 0; i < NUM_FOLLOWERS; i++)
+    {
+        followerFds[i] = openSocket();
+        followerAddresses[i] = addressOf(followerFds[i]);
+    }
+
+    int leaderPipe[2];
+    if (pipe(leaderPipe) != 0)
+    {
+        perror("pipe");
+        return 2;
+    }
+    pid_t leader = fork();
+    if (leader == 0)
+    {
+        Clock clock;
+        clock.skew = leaderSkew;
+        std::atomic<uint32_t> epoch(1);
+        std::thread server(serveFollowers, leaderFd, std::ref(clock), std::ref(epoch), followerAddresses, start);
+        server.detach();
+        int64_t flipAt = waitForFlip([&]() { return clock.now(); }, []() { return (int64_t)0; });
+        ssize_t written = write(leaderPipe[1], &flipAt, sizeof(flipAt));
+        if (written != sizeof(flipAt))
+            _exit(2);
+        pause();  // keep answering until the followers are done
+        _exit(0);
+    }
+    close(leaderPipe[1]);
+
+    int pipes[NUM_FOLLOWERS][2];
+    pid_t followers[NUM_FOLLOWERS];
+    int64_t followerSkews[NUM_FOLLOWERS];
+    for (int i = 0; i < NUM_FOLLOWERS; i++)
+    {
+        followerSkews[i] = skews(random);
+        if (pipe(pipes[i]) != 0)
+        {
+            perror("pipe");
+            return 2;
+        }
+        followers[i] = fork();
+        if (followers[i] == 0)
+        {
+            Clock clock;
+            clock.skew = followerSkews[i];
+            Result result = runFollower(followerFds[i], clock, finalLeaderSkew, i % 2 == 0, start, 1000 + i);
+            ssize_t written = write(pipes[i][1], &result, sizeof(result));
+            _exit(written == sizeof(result) ? 0 : 2);
+        }
+        close(pipes[i][1]);
+    }
+
+    int64_t leaderFlip = 0;
+    bool passed = read(leaderPipe[0], &leaderFlip, sizeof(leaderFlip)) == sizeof(leaderFlip);
+    printf("leader: flipped %lld us after start, clock stepped by %+lld us before\n", (long long)(leaderFlip - start),
+           (long long)LEADER_STEP_US);
+
+    int64_t worst = 0;
+    for (int i = 0; i < NUM_FOLLOWERS; i++)
+    {
+        Result result = {};
+        bool complete = read(pipes[i][0], &result, sizeof(result)) == sizeof(result);
+        waitpid(followers[i], NULL, 0);
+        close(pipes[i][0]);
+
+        int64_t error = result.flipAt - leaderFlip;
+        bool ok = complete && result.samples > 0 && result.rejected > 0 && llabs(error) <= FLIP_TARGET_US;
+        printf("follower %d: skew %+8lld us%s, %3d samples, %2d late dropped, round trip %5lld us, offset error %+6lld us, "
+               "flip error %+6lld us %s\n",
+               i, (long long)(followerSkews[i] - leaderSkew), i % 2 == 0 ? " (NTP step)" : "", result.samples, result.rejected,
+               (long long)result.roundTrip, (long long)result.offsetError, (long long)error, ok ? "ok" : "FAIL");
+        passed &= ok;
+        worst = llabs(error) > worst ? llabs(error) : worst;
+    }
+
+    kill(leader, SIGTERM);
+    waitpid(leader, NULL, 0);
+
+    printf("worst flip error %lld us, target %lld us\n", (long long)worst, (long long)FLIP_TARGET_US);
+    return passed ? 0 : 1;
+}
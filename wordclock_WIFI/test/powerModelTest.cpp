@@ -0,0 +1,460 @@
+// Renders every minute of both languages in a grid of colours, static and in
+// the rainbow and breathing colour modes, plays the fade, wipe and sparkle
+// brightness steps on each frame and runs every step through
+// powerModel::step() the way showFrame() does. The limited frame must never
+// draw more than the budget.
+// Each budget is replayed on its own thread with the sketch's trace events,
+// the exported Chrome trace must parse and its begin/end events must pair up
+// per thread.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "colorModes.h"
+#include "dialekt.h"
+#include "deutsch.h"
+#include "powerModel.h"
+#include "trace.h"
+
+namespace
+{
+    const uint16_t NUM_LEDS = 114;
+    const size_t FRAME_BYTES = NUM_LEDS * 3;
+    const powerModel::LedModel LED_MODEL = {12500, 12500, 12500, 600};  // same as the sketch
+    const uint16_t POWER_RELEASE_STEP = 8;
+    const uint16_t BUDGETS_MA[] = {200, 800, 3000};
+    const uint8_t LEVELS[] = {0, 128, 255};
+    const uint32_t RAINBOW_MS[] = {0, 512, 1024, 1536, 2048, 2560, 3072, 3584};  // half a hue step apart over one scroll
+    const uint32_t BREATHING_MS[] = {0, 1024, 2048, 3072};                      // rising, peak, falling, trough
+
+    const char *const TRACE_FILE = "powerModelTrace.json";
+
+    // the word layout and strip are shared like on the clock, where only the display task renders
+    Adafruit_NeoPixel strip(NUM_LEDS);
+    std::mutex renderMutex;
+
+    struct Stats
+    {
+        unsigned long frames;
+        unsigned long limited;
+        uint32_t worstUa;
+        bool failed;
+    };
+
+    // same calls as showFrame()
+    void show(const uint8_t *frame, uint32_t budgetUa, uint16_t &powerScale, Stats &stats)
+    {
+        trace::Scope scope(trace::EV_SHOW);
+        uint32_t idle = (uint32_t)LED_MODEL.idle * NUM_LEDS;
+        uint32_t estimate = powerModel::estimateGRB(frame, NUM_LEDS, LED_MODEL);
+        powerScale = powerModel::step(estimate, idle, budgetUa, powerScale, POWER_RELEASE_STEP);
+
+        uint8_t shown[FRAME_BYTES];
+        memcpy(shown, frame, FRAME_BYTES);
+        powerModel::scalePixels(shown, FRAME_BYTES, powerScale);
+        uint32_t drawn = powerModel::estimateGRB(shown, NUM_LEDS, LED_MODEL);
+
+        stats.frames++;
+        stats.limited += powerScale < 256;
+        stats.worstUa = drawn > stats.worstUa ? drawn : stats.worstUa;
+        if (drawn > budgetUa || drawn > powerModel::scaledEstimate(estimate, idle, powerScale))
+        {
+            if (!stats.failed)
+            {
+                printf("  over budget: %u uA drawn, budget %u uA, scale %u\n", drawn, budgetUa, powerScale);
+            }
+            stats.failed = true;
+        }
+    }
+
+    // strip brightness is applied when a pixel is written, like Adafruit_NeoPixel
+    void dim(const uint8_t *frame, uint8_t brightness, uint8_t *out)
+    {
+        for (size_t i = 0; i < FRAME_BYTES; i++)
+        {
+            out[i] = (frame[i] * (brightness + 1)) >> 8;
+        }
+    }
+
+    void playTransitions(const uint8_t *frame, uint32_t budgetUa, uint16_t &powerScale, Stats &stats, std::minstd_rand &random)
+    {
+        trace::Scope scope(trace::EV_TRANSITION);
+        uint8_t step[FRAME_BYTES];
+
+        // fadeOut() / fadeIn()
+        for (int brightness = 255; brightness >= 0; brightness -= 8)
+        {
+            dim(frame, brightness, step);
+            show(step, budgetUa, powerScale, stats);
+        }
+        for (int brightness = 8; brightness <= 255; brightness += 8)
+        {
+            dim(frame, brightness, step);
+            show(step, budgetUa, powerScale, stats);
+        }
+
+        // wipeTransition(): LEDs off one by one, then on one by one, shown every third LED
+        memcpy(step, frame, FRAME_BYTES);
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            memset(step + i * 3, 0, 3);
+            if (i % 3 == 0)
+                show(step, budgetUa, powerScale, stats);
+        }
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            memcpy(step + i * 3, frame + i * 3, 3);
+            if (i % 3 == 0)
+                show(step, budgetUa, powerScale, stats);
+        }
+
+        // sparkleTransition(): same in random order, shown every fifth LED
+        uint16_t order[NUM_LEDS];
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+            order[i] = i;
+        for (uint16_t i = NUM_LEDS - 1; i > 0; i--)
+        {
+            uint16_t j = random() % (i + 1);
+            uint16_t swap = order[i];
+            order[i] = order[j];
+            order[j] = swap;
+        }
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            memset(step + order[i] * 3, 0, 3);
+            if ((NUM_LEDS - i - 1) % 5 == 0)
+                show(step, budgetUa, powerScale, stats);
+        }
+        for (uint16_t i = 0; i < NUM_LEDS; i++)
+        {
+            memcpy(step + order[i] * 3, frame + order[i] * 3, 3);
+            if ((NUM_LEDS - i - 1) % 5 == 0)
+                show(step, budgetUa, powerScale, stats);
+        }
+    }
+
+    // setPixels(): words in the config colour, then the colour mode over the lit words
+    void render(uint8_t language, time_t minutes, uint8_t mode, uint32_t ms, uint8_t red, uint8_t green, uint8_t blue, uint8_t *frame)
+    {
+        std::lock_guard<std::mutex> lock(renderMutex);
+        trace::Scope scope(trace::EV_RENDER);
+        strip.setBrightness(255);
+        strip.clear();
+        clearWords();
+        if (language == 0)
+            dialekt::timeToLeds(minutes * 60, &strip, red, green, blue, 0, nullptr);
+        else
+            deutsch::timeToLeds(minutes * 60, &strip, red, green, blue, 0, nullptr);
+
+        const WordSpan *words;
+        uint8_t numWords = getWords(&words);
+        colorModes::render(mode, &strip, words, numWords, ms, red, green, blue);
+        memcpy(frame, strip.getPixels(), FRAME_BYTES);
+    }
+
+    void replay(uint16_t budgetMa, Stats &stats)
+    {
+        std::minstd_rand random(budgetMa);
+        uint16_t powerScale = 256;
+        uint32_t budgetUa = (uint32_t)budgetMa * 1000;
+        uint8_t frame[FRAME_BYTES];
+
+        for (uint8_t language = 0; language < 2; language++)
+        {
+            // 12 hours cover every word, the minute dots repeat every hour
+            for (time_t minutes = 0; minutes < 12 * 60; minutes++)
+            {
+                for (uint8_t r : LEVELS)
+                    for (uint8_t g : LEVELS)
+                        for (uint8_t b : LEVELS)
+                        {
+                            render(language, minutes, colorModes::MODE_STATIC, 0, r, g, b, frame);
+                            show(frame, budgetUa, powerScale, stats);
+                            playTransitions(frame, budgetUa, powerScale, stats, random);
+
+                            // breathing scales the config colour, the transitions are the same as above
+                            for (uint32_t ms : BREATHING_MS)
+                            {
+                                render(language, minutes, colorModes::MODE_BREATHING, ms, r, g, b, frame);
+                                show(frame, budgetUa, powerScale, stats);
+                            }
+                        }
+
+                // the rainbow ignores the config colour
+                for (uint32_t ms : RAINBOW_MS)
+                {
+                    render(language, minutes, colorModes::MODE_RAINBOW, ms, 255, 255, 255, frame);
+                    show(frame, budgetUa, powerScale, stats);
+                    playTransitions(frame, budgetUa, powerScale, stats, random);
+                }
+            }
+        }
+    }
+
+    // ------------------------------------------------------------
+    // trace check, a small JSON reader is enough for the export
+
+    struct Json
+    {
+        enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+        double number = 0;
+        std::string text;
+        std::vector<Json> items;
+        std::vector<std::pair<std::string, Json>> members;
+
+        const Json *get(const char *key) const
+        {
+            for (const auto &member : members)
+                if (member.first == key)
+                    return &member.second;
+            return nullptr;
+        }
+    };
+
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const std::string &input) : input(input) {}
+
+        // whole input is one value
+        bool read(Json &value)
+        {
+            return parse(value) && (skipSpace(), pos == input.size());
+        }
+
+    private:
+        const std::string &input;
+        size_t pos = 0;
+
+        void skipSpace()
+        {
+            while (pos < input.size() && strchr(" \t\r\n", input[pos]))
+                pos++;
+        }
+
+        bool literal(const char *word)
+        {
+            size_t len = strlen(word);
+            if (input.compare(pos, len, word) != 0)
+                return false;
+            pos += len;
+            return true;
+        }
+
+        bool parseString(std::string &text)
+        {
+            if (input[pos++] != '"')
+                return false;
+            while (pos < input.size() && input[pos] != '"')
+            {
+                if ((unsigned char)input[pos] < 0x20)
+                    return false;
+                if (input[pos] == '\\')
+                {
+                    if (++pos >= input.size() || !strchr("\"\\/bfnrtu", input[pos]))
+                        return false;
+                    if (input[pos] == 'u')
+                        pos += 4;  // kept as is, the export only has ASCII names
+                }
+                text += input[pos++];
+            }
+            return pos++ < input.size();
+        }
+
+        bool parse(Json &value)
+        {
+            skipSpace();
+            if (pos >= input.size())
+                return false;
+
+            char c = input[pos];
+            if (c == '{')
+            {
+                value.type = Json::OBJECT;
+                pos++;
+                skipSpace();
+                if (input[pos] == '}')
+                    return ++pos, true;
+                do
+                {
+                    skipSpace();
+                    std::pair<std::string, Json> member;
+                    if (!parseString(member.first))
+                        return false;
+                    skipSpace();
+                    if (input[pos++] != ':' || !parse(member.second))
+                        return false;
+                    value.members.push_back(member);
+                    skipSpace();
+                } while (input[pos] == ',' && ++pos);
+                return input[pos++] == '}';
+            }
+            if (c == '[')
+            {
+                value.type = Json::ARRAY;
+                pos++;
+                skipSpace();
+                if (input[pos] == ']')
+                    return ++pos, true;
+                do
+                {
+                    value.items.push_back(Json());
+                    if (!parse(value.items.back()))
+                        return false;
+                    skipSpace();
+                } while (input[pos] == ',' && ++pos);
+                return input[pos++] == ']';
+            }
+            if (c == '"')
+            {
+                value.type = Json::STRING;
+                return parseString(value.text);
+            }
+            if (c == '-' || (c >= '0' && c <= '9'))
+            {
+                const char *start = input.c_str() + pos;
+                char *end;
+                value.type = Json::NUMBER;
+                value.number = strtod(start, &end);
+                pos += end - start;
+                return end != start;
+            }
+            if (literal("true") || literal("false"))
+            {
+                value.type = Json::BOOL;
+                return true;
+            }
+            return literal("null");
+        }
+    };
+
+    bool fail(const char *message)
+    {
+        printf("trace: %s\n", message);
+        return false;
+    }
+
+    // Every thread that recorded is named. Per thread an end closes the
+    // innermost open begin of the same name, only scopes opened before the
+    // ring's oldest event may end with nothing open, and nothing stays open.
+    bool checkTrace(const std::string &text, size_t threads)
+    {
+        Json root;
+        if (!JsonReader(text).read(root) || root.type != Json::OBJECT)
+            return fail("export is not valid JSON");
+        const Json *events = root.get("traceEvents");
+        if (!events || events->type != Json::ARRAY)
+            return fail("no traceEvents array");
+
+        std::vector<bool> named(trace::MAX_TASKS + 1, false);
+        std::vector<std::vector<std::string>> open(trace::MAX_TASKS + 1);
+        std::vector<int> truncated(trace::MAX_TASKS + 1, 0);
+        size_t numNamed = 0;
+        size_t numEvents = 0;
+
+        for (const Json &event : events->items)
+        {
+            const Json *name = event.get("name");
+            const Json *phase = event.get("ph");
+            const Json *tid = event.get("tid");
+            if (!name || !phase || name->type != Json::STRING || phase->type != Json::STRING)
+                return fail("event without name or phase");
+            if (phase->text == "M")
+            {
+                if (name->text == "thread_name" && tid && tid->number < named.size())
+                {
+                    named[(size_t)tid->number] = true;
+                    numNamed++;
+                }
+                continue;
+            }
+            if (!tid || tid->type != Json::NUMBER || tid->number >= named.size() || !event.get("ts"))
+                return fail("event without tid or ts");
+
+            size_t task = (size_t)tid->number;
+            if (!named[task])
+                return fail("event on a thread without a name");
+            numEvents++;
+            if (phase->text == "B")
+            {
+                open[task].push_back(name->text);
+            }
+            else if (phase->text == "E")
+            {
+                if (open[task].empty())
+                {
+                    if (++truncated[task] > 2)  // transition around show is the deepest nesting
+                        return fail("end without begin");
+                }
+                else if (open[task].back() != name->text)
+                {
+                    return fail("end does not match the open begin");
+                }
+                else
+                {
+                    open[task].pop_back();
+                }
+            }
+            else
+            {
+                return fail("unexpected phase");
+            }
+        }
+
+        for (const auto &stack : open)
+            if (!stack.empty())
+                return fail("begin without end");
+        if (numNamed != threads)
+            return fail("not every thread is named");
+        if (numEvents != trace::RING_SIZE)
+            return fail("ring not exported whole");
+        printf("trace: %zu events from %zu threads, %s ok\n", numEvents, numNamed, TRACE_FILE);
+        return true;
+    }
+
+    bool exportTrace(size_t threads)
+    {
+        if (!trace::startExport())
+            return fail("export refused");
+
+        std::string text;
+        uint8_t buffer[100];  // smaller than a line, so lines are split across reads
+        size_t len;
+        while ((len = trace::readExport(buffer, sizeof(buffer))) > 0)
+            text.append((const char *)buffer, len);
+
+        std::ofstream(TRACE_FILE) << text;
+        return checkTrace(text, threads);
+    }
+}
+
+int main()
+{
+    const size_t numBudgets = sizeof(BUDGETS_MA) / sizeof(BUDGETS_MA[0]);
+    Stats stats[numBudgets] = {};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numBudgets; i++)
+        threads.push_back(std::thread(replay, BUDGETS_MA[i], std::ref(stats[i])));
+    for (std::thread &thread : threads)
+        thread.join();
+
+    bool passed = true;
+    for (size_t i = 0; i < numBudgets; i++)
+    {
+        printf("budget %4u mA: %lu frames, %lu limited, worst draw %u mA %s\n", BUDGETS_MA[i], stats[i].frames, stats[i].limited,
+               (stats[i].worstUa + 999) / 1000, stats[i].failed ? "FAIL" : "ok");
+        passed &= !stats[i].failed;
+    }
+    passed &= exportTrace(numBudgets);
+
+    return passed ? 0 : 1;
+}
+
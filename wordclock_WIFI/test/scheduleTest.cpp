@@ -0,0 +1,210 @@
+// Compiles a small schedule on the two DST change days of 2026 with the
+// Austrian rules the sketch uses (CET/CEST, switching at 01:00 UTC on the
+// last Sunday of March and October). The short day has 23 hours and skips
+// 02:00-03:00, the long day has 25 hours and repeats 02:00-03:00.
+// due() is then ticked across both days like the display task ticks it.
+#include <cstdio>
+#include <ctime>
+#include <vector>
+#include "schedule.h"
+
+namespace
+{
+    using namespace schedule;
+
+    bool passed = true;
+
+    void check(bool ok, const char *what)
+    {
+        if (!ok)
+        {
+            printf("  FAIL: %s\n", what);
+            passed = false;
+        }
+    }
+
+    time_t utcOf(int year, int month, int day, int hour, int minute)
+    {
+        struct tm t = {};
+        t.tm_year = year - 1900;
+        t.tm_mon = month - 1;
+        t.tm_mday = day;
+        t.tm_hour = hour;
+        t.tm_min = minute;
+        return timegm(&t);
+    }
+
+    // 01:00 UTC on the last Sunday of the month
+    time_t lastSunday(int year, int month)
+    {
+        time_t last = utcOf(year, month, 31, 1, 0);
+        struct tm t;
+        gmtime_r(&last, &t);
+        return last - t.tm_wday * 86400;
+    }
+
+    // stands in for Timezone::toLocal with the AT rules
+    time_t toLocal(time_t utc)
+    {
+        struct tm t;
+        gmtime_r(&utc, &t);
+        int year = t.tm_year + 1900;
+        bool summer = utc >= lastSunday(year, 3) && utc < lastSunday(year, 10);
+        return utc + (summer ? 7200 : 3600);
+    }
+
+    void print(const Timetable &table)
+    {
+        printf("  day %ld h, %u carried:", (long)(table.dayEnd - table.dayStart) / 3600, table.numCarried);
+        for (uint8_t i = 0; i < table.numPoints; i++)
+        {
+            time_t at = table.points[i].at;
+            struct tm t;
+            gmtime_r(&at, &t);
+            printf(" %u@%02d:%02dZ", table.points[i].rule, t.tm_hour, t.tm_min);
+        }
+        printf("\n");
+    }
+
+    bool sorted(const Timetable &table)
+    {
+        for (uint8_t i = 1; i < table.numPoints; i++)
+        {
+            if (table.points[i].at < table.points[i - 1].at)
+                return false;
+        }
+        return true;
+    }
+
+    // today's points of a rule, and the time of the last one
+    uint8_t pointsToday(const Timetable &table, uint8_t rule, time_t &at)
+    {
+        uint8_t count = 0;
+        for (uint8_t i = table.numCarried; i < table.numPoints; i++)
+        {
+            if (table.points[i].rule == rule)
+            {
+                at = table.points[i].at;
+                count++;
+            }
+        }
+        return count;
+    }
+
+    const time_t TICK = 10;
+
+    // Ticks due() from one UTC time to another, the first tick compiles the
+    // day like the sketch's first compile. Fires after the first tick are
+    // today's points in order, each on the first tick at or after its time.
+    void replay(const Rule *rules, uint8_t numRules, time_t from, time_t to, const char *what)
+    {
+        Timetable table;
+        compile(rules, numRules, from, toLocal, table);
+
+        std::vector<ChangePoint> fired;
+        bool carriedLater = false;
+        bool late = false;
+        for (time_t utc = from; utc <= to; utc += TICK)
+        {
+            for (uint8_t i = due(rules, numRules, utc, toLocal, table); i < table.next; i++)
+            {
+                if (utc == from)
+                    continue;  // carried points of the first compile
+                carriedLater |= i < table.numCarried;
+                late |= utc < table.points[i].at || utc - table.points[i].at >= TICK;
+                fired.push_back(table.points[i]);
+            }
+        }
+
+        // today's points of every day in between, compiled on their own
+        std::vector<ChangePoint> expected;
+        Timetable day;
+        for (time_t utc = from; utc <= to; utc = day.dayEnd)
+        {
+            compile(rules, numRules, utc, toLocal, day);
+            for (uint8_t i = day.numCarried; i < day.numPoints; i++)
+            {
+                if (day.points[i].at > from && day.points[i].at <= to)
+                    expected.push_back(day.points[i]);
+            }
+        }
+
+        bool same = fired.size() == expected.size();
+        for (size_t i = 0; same && i < fired.size(); i++)
+            same = fired[i].at == expected[i].at && fired[i].rule == expected[i].rule;
+
+        printf("  %s: %zu points fired\n", what, fired.size());
+        check(!carriedLater, "no carried point after a finished day");
+        check(!late, "points fire on the first tick at their time");
+        check(same, "every point of each day fires once, none again");
+    }
+}
+
+int main()
+{
+    Rule rules[4] = {};
+    rules[0] = {ALL_DAYS, FIELD_BRIGHTNESS, 22 * 60, 30, 0, 0, 0, 0, 0};                  // dim at night
+    rules[1] = {0x3E, FIELD_BRIGHTNESS | FIELD_COLOR, 7 * 60, 200, 255, 200, 100, 0, 0};  // weekday mornings
+    rules[2] = {ALL_DAYS, FIELD_POWER, 2 * 60 + 30, 0, 0, 0, 0, 0, 0};                   // off at 02:30, inside the DST hour
+    rules[3] = {0x41, FIELD_BRIGHTNESS, 9 * 60, 150, 0, 0, 0, 0, 0};                      // weekends 09:00
+    for (const Rule &rule : rules)
+        check(isValid(rule), "rule valid");
+
+    Timetable table;
+    time_t at = 0;
+
+    printf("2026-03-29, CET -> CEST\n");
+    compile(rules, 4, utcOf(2026, 3, 29, 12, 0), toLocal, table);
+    print(table);
+    check(table.dayStart == utcOf(2026, 3, 28, 23, 0), "day starts at local midnight");
+    check(table.dayEnd - table.dayStart == 23 * 3600, "23 hour day");
+    check(pointsToday(table, 2, at) == 1 && at == utcOf(2026, 3, 29, 1, 0), "skipped 02:30 fires at the end of the gap");
+    check(pointsToday(table, 3, at) == 1 && at == utcOf(2026, 3, 29, 7, 0), "09:00 CEST");
+    check(pointsToday(table, 0, at) == 1 && at == utcOf(2026, 3, 29, 20, 0), "22:00 CEST");
+    check(pointsToday(table, 1, at) == 0, "weekday rule not on Sunday");
+    check(sorted(table), "points sorted");
+    check(nextChange(table) == table.dayStart, "carried rules due at once");
+
+    printf("2026-10-25, CEST -> CET\n");
+    compile(rules, 4, utcOf(2026, 10, 25, 12, 0), toLocal, table);
+    print(table);
+    check(table.dayStart == utcOf(2026, 10, 24, 22, 0), "day starts at local midnight");
+    check(table.dayEnd - table.dayStart == 25 * 3600, "25 hour day");
+    check(pointsToday(table, 2, at) == 1 && at == utcOf(2026, 10, 25, 0, 30), "repeated 02:30 fires once, in CEST");
+    check(pointsToday(table, 3, at) == 1 && at == utcOf(2026, 10, 25, 8, 0), "09:00 CET");
+    check(pointsToday(table, 0, at) == 1 && at == utcOf(2026, 10, 25, 21, 0), "22:00 CET");
+    check(sorted(table), "points sorted");
+
+    printf("2026-10-26, day after\n");
+    compile(rules, 4, utcOf(2026, 10, 26, 12, 0), toLocal, table);
+    print(table);
+    check(table.dayEnd - table.dayStart == 24 * 3600, "24 hour day");
+    check(table.numCarried == 3 && table.points[0].rule == 1 && table.points[1].rule == 2 && table.points[2].rule == 0,
+          "carried rules in order of their last change");
+
+    printf("due() across the DST days\n");
+    replay(rules, 4, utcOf(2026, 3, 28, 12, 0), utcOf(2026, 3, 30, 12, 0), "2026-03-28 to 03-30");
+    replay(rules, 4, utcOf(2026, 10, 24, 12, 0), utcOf(2026, 10, 26, 12, 0), "2026-10-24 to 10-26");
+
+    // ticks missed over midnight, e.g. a long NTP wait: the day was not finished so the carried points apply
+    compile(rules, 4, utcOf(2026, 10, 25, 20, 0), toLocal, table);
+    uint8_t first = due(rules, 4, utcOf(2026, 10, 25, 20, 0), toLocal, table);
+    check(first == 0 && table.next == table.numPoints - 1, "first tick applies everything up to now, 22:00 left");
+    first = due(rules, 4, utcOf(2026, 10, 25, 23, 30), toLocal, table);
+    check(first == 0 && table.next == table.numCarried && table.points[table.next - 1].rule == 0,
+          "missed 22:00 applies as a carried point after midnight");
+    first = due(rules, 4, utcOf(2026, 10, 25, 23, 30), toLocal, table);
+    check(first == table.next, "nothing due twice");
+
+    // every local time maps back to its first UTC occurrence
+    bool roundTrip = true;
+    for (time_t utc = utcOf(2026, 1, 1, 0, 0); utc < utcOf(2027, 1, 1, 0, 0); utc += 600)
+    {
+        time_t back = localToUtc(toLocal(utc), toLocal);
+        roundTrip &= back <= utc && toLocal(back) == toLocal(utc);
+    }
+    check(roundTrip, "localToUtc round trip over 2026");
+
+    printf("%s\n", passed ? "ok" : "FAIL");
+    return passed ? 0 : 1;
+}
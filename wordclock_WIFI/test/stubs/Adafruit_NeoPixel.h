@@ -0,0 +1,75 @@
+#ifndef ADAFRUIT_NEOPIXEL_STUB_H
+#define ADAFRUIT_NEOPIXEL_STUB_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Pixel buffer in wire order (GRB) with the library's brightness scaling on write
+class Adafruit_NeoPixel
+{
+public:
+    static const uint16_t MAX_LEDS = 128;
+
+    explicit Adafruit_NeoPixel(uint16_t numLeds) : numLeds(numLeds), brightness(0)
+    {
+        clear();
+    }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+    {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    // stored like the library: 0 means full brightness, otherwise value + 1
+    void setBrightness(uint8_t value)
+    {
+        brightness = value + 1;
+    }
+
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (n >= numLeds)
+        {
+            return;
+        }
+        if (brightness)
+        {
+            r = (r * brightness) >> 8;
+            g = (g * brightness) >> 8;
+            b = (b * brightness) >> 8;
+        }
+        pixels[n * 3] = g;
+        pixels[n * 3 + 1] = r;
+        pixels[n * 3 + 2] = b;
+    }
+
+    void setPixelColor(uint16_t n, uint32_t color)
+    {
+        setPixelColor(n, color >> 16, color >> 8, color);
+    }
+
+    void clear()
+    {
+        memset(pixels, 0, sizeof(pixels));
+    }
+
+    uint8_t *getPixels()
+    {
+        return pixels;
+    }
+
+    uint16_t numPixels() const
+    {
+        return numLeds;
+    }
+
+private:
+    uint16_t numLeds;
+    uint16_t brightness;
+    uint8_t pixels[MAX_LEDS * 3];
+};
+
+#define NEO_GRB 0
+#define NEO_KHZ800 0
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+// Just enough of the Arduino core to build the word modules on the host
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define TWO_PI 6.283185307179586476925286766559
+
+class String : public std::string
+{
+public:
+    String() {}
+    String(const char *value) : std::string(value) {}
+    String(const std::string &value) : std::string(value) {}
+    explicit String(long value) : std::string(std::to_string(value)) {}
+
+    bool endsWith(const char *suffix) const
+    {
+        size_t len = strlen(suffix);
+        return size() >= len && compare(size() - len, len, suffix) == 0;
+    }
+};
+
+inline long random(long max)
+{
+    return rand() % max;
+}
+
+inline long random()
+{
+    return rand();
+}
+
+#endif
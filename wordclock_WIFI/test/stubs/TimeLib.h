@@ -0,0 +1,16 @@
+#ifndef TIMELIB_STUB_H
+#define TIMELIB_STUB_H
+
+#include <time.h>
+
+inline int hour(time_t t)
+{
+    return (t / 3600) % 24;
+}
+
+inline int minute(time_t t)
+{
+    return (t / 60) % 60;
+}
+
+#endif
@@ -0,0 +1,232 @@
+// Drives the HTTP API module with request mixes seen on a real clock and
+// reports requests/s, heap bytes allocated per request and p99 handler time.
+// A handler here does what the sketch's handler does around the module:
+// /update applies the body and, if something changed, serializes the
+// settings once and hands a copy to every SSE subscriber like
+// AsyncEventSource does. /status builds the status document.
+// Allocation counts are those of the host std::string, which keeps short
+// strings inline (SSO), not those of the device's Arduino String, so small
+// bodies count lower here than they would on the clock.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "webApi.h"
+
+namespace
+{
+    bool counting = false;
+    size_t allocatedBytes = 0;
+    size_t allocations = 0;
+}
+
+void *operator new(size_t size)
+{
+    if (counting)
+    {
+        allocatedBytes += size;
+        allocations++;
+    }
+    void *p = malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    const uint8_t NUM_COLOR_MODES = 5;  // colorModes::NUM_MODES
+    const int REPEAT = 20;
+
+    struct Request
+    {
+        bool status;  // GET /status, otherwise POST /update
+        std::string body;
+    };
+
+    struct Mix
+    {
+        const char *name;
+        int subscribers;
+        std::vector<Request> requests;
+    };
+
+    Config config = {255, 255, 255, 128, "dialekt", true, TRANSITION_FADE, PREFIX_ALWAYS, 2, false, 0, 800, 0, {}, 0};
+    long bootPhaseMs[8] = {12, 40, 3, 8, 120, 2400, 60, 900};
+    const char *const bootPhaseNames[8] = {"fs", "settings", "leds", "rtc", "firstFrame", "wifi", "services", "ntp"};
+    size_t sink = 0;  // keeps the outputs alive
+
+    void handleUpdate(const std::string &body, int subscribers)
+    {
+        webApi::UpdateResult result = webApi::applyUpdate((const uint8_t *)body.data(), body.size(), config, NUM_COLOR_MODES);
+        if (!result.valid)
+        {
+            fprintf(stderr, "invalid request: %s\n", body.c_str());
+            exit(1);
+        }
+        if (result.changes)
+        {
+            Text settings;
+            webApi::writeSettings(config, settings);
+            for (int i = 0; i < subscribers; i++)
+            {
+                Text message(settings);
+                sink += message.size();
+            }
+        }
+    }
+
+    void handleStatus()
+    {
+        webApi::StatusInfo info = {};
+        info.powerMa = 412;
+        info.bootPhaseMs = bootPhaseMs;
+        info.bootPhaseNames = bootPhaseNames;
+        info.numBootPhases = 8;
+        info.hasColorRender = true;
+        info.colorRenderUs = 180;
+        info.colorRenderMaxUs = 260;
+        info.colorRenderBudgetUs = 400;
+        info.colorFrameUs = 3900;
+        info.syncRole = 2;
+        info.hasSyncOffset = true;
+        info.syncOffsetUs = -1834;
+        info.syncRoundTripUs = 2210;
+        info.hasScheduleChange = true;
+        info.nextScheduleChange = 1792969200;
+
+        Text response;
+        webApi::writeStatus(config, info, response);
+        sink += response.size();
+    }
+
+    std::string field(const char *name, int value)
+    {
+        return std::string("{\"") + name + "\":" + std::to_string(value) + "}";
+    }
+
+    // the UI sends on every input event, so a drag repeats values and ends with the release
+    Mix sliderDrag()
+    {
+        Mix mix = {"slider drag", 2, {}};
+        for (int burst = 0; burst < 10; burst++)
+        {
+            for (int brightness = 20; brightness <= 220; brightness += 4)
+            {
+                mix.requests.push_back({false, field("brightness", brightness)});
+                mix.requests.push_back({false, field("brightness", brightness)});
+            }
+            for (int red = 255; red >= 0; red -= 8)
+            {
+                mix.requests.push_back({false, field("red", red)});
+            }
+        }
+        return mix;
+    }
+
+    // every update changes something and goes out to a room full of open UIs
+    Mix sseFanOut()
+    {
+        Mix mix = {"16 SSE subscribers", 16, {}};
+        for (int i = 0; i < 400; i++)
+        {
+            mix.requests.push_back({false, "{\"red\":" + std::to_string(i % 256) + ",\"green\":40,\"blue\":200}"});
+        }
+        return mix;
+    }
+
+    Mix statusPoll()
+    {
+        Mix mix = {"status poll", 0, {}};
+        for (int i = 0; i < 400; i++)
+        {
+            mix.requests.push_back({true, ""});
+        }
+        return mix;
+    }
+
+    // schedule edits carry the whole rule list
+    Mix scheduleEdit()
+    {
+        Mix mix = {"schedule edit", 2, {}};
+        for (int i = 0; i < 200; i++)
+        {
+            std::string body = "{\"schedule\":[";
+            for (int rule = 0; rule < 8; rule++)
+            {
+                body += rule ? "," : "";
+                body += "{\"days\":127,\"minute\":" + std::to_string((i + rule * 180) % 1440) +
+                        ",\"brightness\":40,\"red\":255,\"green\":80,\"blue\":0,\"enabled\":true,\"transition\":1}";
+            }
+            body += "]}";
+            mix.requests.push_back({false, body});
+        }
+        return mix;
+    }
+
+    void run(const Mix &mix)
+    {
+        std::vector<double> times;
+        times.reserve(mix.requests.size() * REPEAT);
+        size_t bytes = 0;
+        size_t count = 0;
+        double total = 0;
+
+        for (int repeat = 0; repeat < REPEAT; repeat++)
+        {
+            for (const Request &request : mix.requests)
+            {
+                allocatedBytes = 0;
+                allocations = 0;
+                counting = true;
+                auto start = std::chrono::steady_clock::now();
+                if (request.status)
+                {
+                    handleStatus();
+                }
+                else
+                {
+                    handleUpdate(request.body, mix.subscribers);
+                }
+                auto end = std::chrono::steady_clock::now();
+                counting = false;
+
+                double us = std::chrono::duration<double, std::micro>(end - start).count();
+                times.push_back(us);
+                total += us;
+                bytes += allocatedBytes;
+                count += allocations;
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+        double p99 = times[(times.size() * 99) / 100];
+        printf("%-20s %10.0f req/s %8.1f bytes/req %6.2f allocs/req %8.2f us p99\n", mix.name,
+               times.size() / (total / 1e6), (double)bytes / times.size(), (double)count / times.size(), p99);
+    }
+}
+
+int main()
+{
+    printf("%-20s %16s %18s %17s %14s\n", "mix", "throughput", "allocated", "allocations", "handler");
+    run(sliderDrag());
+    run(sseFanOut());
+    run(statusPoll());
+    run(scheduleEdit());
+    return sink > 0 ? 0 : 1;
+}
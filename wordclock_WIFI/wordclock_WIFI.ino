@@ -9,14 +9,25 @@
 #include <ESPmDNS.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
+#include <AsyncUDP.h>
 #include <NTPClient.h>
 
 #include <Adafruit_NeoPixel.h>
 
 #include <ESP32Time.h>
+#include <RTClib.h>
+#include <sys/time.h>
 
 #include "src/dialekt.h"
 #include "src/deutsch.h"
+#include "src/clockSync.h"
+#include "src/frameStream.h"
+#include "src/powerModel.h"
+#include "src/colorModes.h"
+#include "src/config.h"
+#include "src/schedule.h"
+#include "src/webApi.h"
+#include "src/trace.h"
 
 #define VERSION "4.1"
 
@@ -24,43 +35,28 @@
 #define AP_SSID "WordClock-Setup"
 #define DNS_NAME "wordclock"
 
+// define multi-clock sync params
+#define SYNC_MULTICAST_IP IPAddress(239, 255, 42, 99)
+
 // define matrix params
 #define LED_PIN 4  // define pin for LEDs
 #define NUM_LEDS 114
 
-// define preferences namespace
-#define PREFS_NAMESPACE "wordclock"
+// define colour animation params
+#define COLOR_FRAME_MS 20  // animated colour modes run at 50 fps
 
-// Transition animation types
-enum TransitionType {
-  TRANSITION_NONE = 0,    // No animation, instant change
-  TRANSITION_FADE = 1,    // Fade out old, fade in new
-  TRANSITION_WIPE = 2,    // Wipe from left to right
-  TRANSITION_SPARKLE = 3  // Random sparkle effect
-};
+// define power limit params
+#define POWER_RELEASE_STEP 8      // scale recovery per frame (of 256) once the draw drops
 
-// ES IST/ES ISCH display modes
-enum PrefixMode {
-  PREFIX_ALWAYS = 0,  // Always show ES IST/ES ISCH
-  PREFIX_RANDOM = 1,  // Randomly show or hide
-  PREFIX_OFF = 2      // Never show ES IST/ES ISCH
-};
+// define live mirror params
+#define FRAME_CLIENTS 4         // max web UI viewers of the live mirror
+#define FRAME_MIN_INTERVAL 50   // min ms between frames per viewer (20 fps)
 
-struct Config {
-  uint8_t red;              // red component (0-255)
-  uint8_t green;            // green component (0-255)
-  uint8_t blue;             // blue component (0-255)
-  uint8_t brightness;       // brightness (1-255, mapped from 1-100% slider)
-  String language;          // language
-  bool enabled;             // wordclock on/off state
-  uint8_t transition;       // transition animation type
-  uint8_t prefixMode;       // ES IST/ES ISCH display mode
-  uint8_t transitionSpeed;  // transition speed: 1=slow, 2=medium, 3=fast
-  bool superBright;         // superbright mode: false=5-80%, true=5-100%
-};
+// define preferences namespace
+#define PREFS_NAMESPACE "wordclock"
 
 // create config object and set default values
-Config config = { 255, 255, 255, 128, "dialekt", true, TRANSITION_FADE, PREFIX_ALWAYS, 2, false };
+Config config = { 255, 255, 255, 128, "dialekt", true, TRANSITION_FADE, PREFIX_ALWAYS, 2, false, clockSync::ROLE_OFF, 800, colorModes::MODE_STATIC };
 
 // Status states for animation
 enum StatusState {
@@ -71,12 +67,36 @@ enum StatusState {
 };
 
 uint8_t lastMin = 255;  // Initialize to 255 to prevent animation on first display
-bool update = false;
+bool update = false;  // Set by /update, consumed with an atomic exchange by the display task
 bool playPreviewAnimation = false;
 bool wifiConnected = false;
 bool timeIsSynced = false;
+bool timeIsValid = false;  // Time known from DS3231 or NTP, status animations no longer needed
+bool hasDS3231 = false;
 StatusState currentStatus = STATUS_BOOT;
 
+// Boot phases, measured for serial output and the status API
+enum BootPhase {
+  BOOT_FS = 0,           // mount LittleFS
+  BOOT_SETTINGS = 1,     // load preferences
+  BOOT_LEDS = 2,         // init LED strip
+  BOOT_RTC = 3,          // read DS3231
+  BOOT_FIRST_FRAME = 4,  // app start until the time is first shown
+  BOOT_WIFI = 5,         // WiFiManager connect
+  BOOT_SERVICES = 6,     // mDNS and webserver in parallel, then clock sync
+  BOOT_NTP = 7,          // NTP client started until first sync, next to the services
+  NUM_BOOT_PHASES = 8
+};
+
+const char *BOOT_PHASE_NAMES[NUM_BOOT_PHASES] = { "fs", "settings", "leds", "rtc", "firstFrame", "wifi", "services", "ntp" };
+long bootPhaseMs[NUM_BOOT_PHASES] = { -1, -1, -1, -1, -1, -1, -1, -1 };  // -1 = not measured yet
+unsigned long ntpStartedAt = 0;
+
+// Services started in parallel once WiFi is up, their start tasks set these bits when done
+EventGroupHandle_t serviceEvents = NULL;
+const EventBits_t SERVICE_MDNS_STARTED = BIT0;
+const EventBits_t SERVICE_NTP_FETCHED = BIT1;
+
 // NTP timing
 unsigned long nextTimeSync = 0;
 const unsigned long NTP_SYNC_INTERVAL = 3600000;  // 1 hour in milliseconds
@@ -84,6 +104,70 @@ const unsigned long NTP_RETRY_INTERVAL = 30000;   // 30 seconds for failed attem
 unsigned long lastWiFiCheck = 0;
 const unsigned long WIFI_CHECK_INTERVAL = 10000;  // Check WiFi every 10 seconds
 
+// Multi-clock sync
+uint8_t syncStartedMode = clockSync::ROLE_OFF;  // config.syncMode the sync was last started with
+uint8_t syncRunningRole = clockSync::ROLE_OFF;  // role actually running
+bool syncLeaderKnown = false;
+IPAddress syncLeaderIP;
+uint32_t syncSequence = 0;
+int64_t syncTransitionStart = 0;  // leader's next minute transition (leader clock)
+volatile uint32_t syncClockEpoch = 0;  // bumped on every NTP step, followers drop older samples
+unsigned long lastSyncDiscovery = 0;
+const unsigned long SYNC_DISCOVERY_INTERVAL = 30000;  // Look for a leader every 30 seconds
+uint8_t syncUnanswered = 0;                          // Requests sent since the last response
+const uint8_t SYNC_LEADER_TIMEOUT = 5;               // Unanswered requests before the leader is dropped
+const uint32_t SYNC_REPORT_INTERVAL = 60;            // Requests between sync quality reports on serial
+portMUX_TYPE syncMux = portMUX_INITIALIZER_UNLOCKED;
+
+// WS2812B current model in µA per channel at full scale, plus quiescent draw per LED
+const powerModel::LedModel LED_MODEL = { 12500, 12500, 12500, 600 };
+uint16_t powerScale = 256;        // current limiter scale (256 = unlimited), eases back up after a cut
+uint16_t estimatedPowerMa = 0;    // estimated draw of the last frame shown
+
+// Render time budget of one animated frame in µs, excluding show(): a tenth of the frame period.
+// show() alone holds core 1 for ~3.4 ms (114 LEDs x 24 bit x 1.25 µs), the rest is left to the other tasks
+const unsigned long COLOR_RENDER_BUDGET_US = COLOR_FRAME_MS * 1000UL / 10;
+unsigned long colorRenderUs = 0;                  // render time of the last animated frame
+unsigned long colorRenderMaxUs = 0;               // worst render time since the mode was selected
+unsigned long colorFrameUs = 0;                   // render + show of the last animated frame
+uint8_t colorStatsMode = colorModes::MODE_STATIC;  // mode the stats belong to
+portMUX_TYPE colorStatsMux = portMUX_INITIALIZER_UNLOCKED;  // display task writes, /status reads
+
+// Display schedule, compiled once per local day into the change points the display task waits for
+schedule::Rule scheduleRules[schedule::MAX_RULES];  // rules the timetable was compiled from
+uint8_t scheduleNumRules = 0;
+schedule::Timetable timetable = {};
+bool timetableCompiled = false;
+time_t scheduleNextChange = 0;                     // UTC of the next change point for /status, 0 = none, guarded by scheduleMux
+schedule::Rule pendingRules[schedule::MAX_RULES];  // handed over from /update, guarded by scheduleMux
+uint8_t pendingNumRules = 0;
+volatile bool scheduleChanged = false;           // Recompile from pendingRules
+volatile bool settingsBroadcastPending = false;  // Scheduled change for the network task to broadcast
+portMUX_TYPE scheduleMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Settings a rule may override, as last set by hand. NVS stores these, config holds what is shown
+struct ManualSettings {
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+  uint8_t brightness;
+  bool enabled;
+  uint8_t transition;
+};
+ManualSettings manualSettings;
+
+// Live mirror viewers, each one gets deltas against the last frame it received
+struct FrameClient {
+  AsyncWebSocketClient *client;  // nullptr = free slot, only dereferenced under frameLock
+  uint32_t id;                   // sends go through frameSocket by id, outside the lock
+  bool hasFrame;                 // false: next frame is a keyframe
+  unsigned long lastSent;        // millis() of the last frame sent
+  uint8_t frame[NUM_LEDS * 3];   // last frame sent (RGB)
+};
+FrameClient frameClients[FRAME_CLIENTS];
+volatile uint8_t frameViewers = 0;  // slots in use
+SemaphoreHandle_t frameLock = NULL;  // Guards the slots, the disconnect event clears a slot before the client is freed
+
 // Minute LED positions (corner LEDs on typical word clocks)
 const uint8_t MINUTE_LEDS[] = { 110, 111, 112, 113 };  // Adjust these to your LED layout
 const uint8_t NUM_MINUTE_LEDS = 4;
@@ -101,13 +185,18 @@ WiFiManager wm;
 // create webserver
 AsyncWebServer server(80);
 AsyncEventSource events("/events");
+AsyncWebSocket frameSocket("/frames");
 
 // NTP management
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP);
 
+// multi-clock sync socket
+AsyncUDP syncUDP;
+
 // RTC management
 ESP32Time rtc;
+RTC_DS3231 ds3231;  // battery backed, keeps time across power loss
 
 // create NeoPixel strip
 Adafruit_NeoPixel strip(NUM_LEDS, LED_PIN, NEO_GRB + NEO_KHZ800);
@@ -133,76 +222,82 @@ uint8_t applySuperBrightCap(uint8_t brightness) {
 // ------------------------------------------------------------
 // Safe serial printing functions to prevent task preemption corruption
 
-void serialPrint(const String &str) {
-  Serial.print(str);
+volatile bool serialMuted = false;  // dumpTrace owns the port, other output would break its JSON
+
+void serialWrite(const String &str, bool newline) {
+  if (serialMuted) {
+    return;
+  }
+  trace::Scope scope(trace::EV_SERIAL);
+  if (newline) {
+    Serial.println(str);
+  } else {
+    Serial.print(str);
+  }
   Serial.flush();
   vTaskDelay(1);
 }
 
+void serialPrint(const String &str) {
+  serialWrite(str, false);
+}
+
 void serialPrint(const __FlashStringHelper *str) {
-  Serial.print(str);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(String(str), false);
 }
 
 void serialPrint(int val) {
-  Serial.print(val);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(String(val), false);
 }
 
 void serialPrint(unsigned long val) {
-  Serial.print(val);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(String(val), false);
 }
 
 void serialPrintln(const String &str) {
-  Serial.println(str);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(str, true);
 }
 
 void serialPrintln(const __FlashStringHelper *str) {
-  Serial.println(str);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(String(str), true);
 }
 
 void serialPrintln(int val) {
-  Serial.println(val);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(String(val), true);
 }
 
 void serialPrintln(unsigned long val) {
-  Serial.println(val);
-  Serial.flush();
-  vTaskDelay(1);
+  serialWrite(String(val), true);
 }
 
 void setup() {
   Serial.begin(115200);
   Serial.println(F("WordClock v" VERSION " by kaufi95"));
 
+  unsigned long phaseStart = millis();
   while (!LittleFS.begin(true)) {
     Serial.println(F("File system mount failed..."));
     ESP.restart();
   }
   Serial.println(F("File system mounted"));
-  delay(1000);
+  recordBootPhase(BOOT_FS, phaseStart);
 
+  phaseStart = millis();
   loadSettings();
+  recordBootPhase(BOOT_SETTINGS, phaseStart);
 
+  phaseStart = millis();
   strip.begin();
   strip.setBrightness(applySuperBrightCap(config.brightness));
   strip.clear();
   strip.show();
   Serial.println("LED strip initialized");
-  delay(1000);
+  recordBootPhase(BOOT_LEDS, phaseStart);
 
-  Serial.println(F("Initializing RTC with placeholder time"));
-  rtc.setTime(0, 0, 0, 1, 1, 2020);
+  // Show the DS3231 time right away, WiFi and NTP come up in the background
+  phaseStart = millis();
+  loadTimeFromDS3231();
+  recordBootPhase(BOOT_RTC, phaseStart);
 
   // Configure WiFiManager (but don't connect yet)
   WiFi.setHostname(DNS_NAME);
@@ -215,6 +310,9 @@ void setup() {
   wm.setConnectRetries(1);
   wm.setConnectTimeout(5);
 
+  frameLock = xSemaphoreCreateMutex();
+  serviceEvents = xEventGroupCreate();
+
   // Create tasks - they will handle WiFi and display
   xTaskCreatePinnedToCore(
     displayTask,
@@ -234,7 +332,6 @@ void setup() {
     &networkTaskHandle,
     0);
 
-  delay(1000);
   Serial.println(F("Tasks created"));
 }
 
@@ -242,10 +339,33 @@ void setup() {
 // main
 
 void loop() {
-  // Tasks handle everything now, so loop just sleeps
+  // Tasks handle everything now, loop only listens for 't' to dump the trace over serial
+  if (Serial.available() && Serial.read() == 't') {
+    dumpTrace();
+  }
   vTaskDelay(pdMS_TO_TICKS(1000));
 }
 
+void dumpTrace() {
+  if (!trace::startExport()) {
+    serialPrintln(F("Trace export already running"));
+    return;
+  }
+
+  // Let serialPrint calls that are already writing finish, then mute them for the dump
+  serialMuted = true;
+  Serial.flush();
+  vTaskDelay(pdMS_TO_TICKS(10));
+
+  uint8_t buffer[128];
+  size_t len;
+  while ((len = trace::readExport(buffer, sizeof(buffer))) > 0) {
+    Serial.write(buffer, len);
+  }
+  Serial.flush();
+  serialMuted = false;
+}
+
 void updateTime() {
   if (!wifiConnected) {
     return;
@@ -256,20 +376,31 @@ void updateTime() {
     return;
   }
 
-  currentStatus = STATUS_NTP;
+  setStatus(STATUS_NTP);
 
+  trace::begin(trace::EV_NTP_SYNC);
   timeClient.forceUpdate();
+  trace::end(trace::EV_NTP_SYNC);
   bool updateSuccess = timeClient.isTimeSet();
 
   if (updateSuccess) {
     time_t time = timeClient.getEpochTime();
-    delay(500);
 
     if (time > 1577836800) {
+      int64_t beforeStep = localMicros();
       rtc.setTime(time);
+      shiftClockSyncOffset(localMicros() - beforeStep);  // Followers keep flipping with the leader across the step
+      syncClockEpoch++;                                  // As a leader, tell the followers their samples are stale
+      if (hasDS3231) {
+        ds3231.adjust(DateTime((uint32_t)time));
+      }
       timeIsSynced = true;
-      currentStatus = STATUS_READY;
+      timeIsValid = true;
+      setStatus(STATUS_READY);
       displayTimeInfo(AT.toLocal(time));
+      if (bootPhaseMs[BOOT_NTP] < 0) {
+        recordBootPhase(BOOT_NTP, ntpStartedAt);
+      }
 
       nextTimeSync = now + NTP_SYNC_INTERVAL;
       String msg = "Next NTP sync in " + String((int)(NTP_SYNC_INTERVAL / 60000)) + " minutes";
@@ -303,6 +434,51 @@ void printSettings() {
 
   String line4 = "Transition: " + String(config.transition) + ", Speed: " + String(config.transitionSpeed);
   serialPrintln(line4);
+
+  String line5 = "SyncMode: " + String(config.syncMode) + ", PowerBudget: " + String(config.powerBudget) + " mA";
+  serialPrintln(line5);
+
+  String line6 = "ColorMode: " + String(config.colorMode) + ", Schedule: " + String(config.numRules) + " rules";
+  serialPrintln(line6);
+}
+
+// Status animations only replace the time as long as no valid time is known
+void setStatus(StatusState status) {
+  if (!timeIsValid || status == STATUS_READY) {
+    currentStatus = status;
+  }
+}
+
+void recordBootPhase(BootPhase phase, unsigned long start) {
+  unsigned long now = millis();
+  bootPhaseMs[phase] = now - start;
+  String msg = "Boot phase " + String(BOOT_PHASE_NAMES[phase]) + ": " + String(bootPhaseMs[phase]) + " ms (at " + String(now) + " ms)";
+  serialPrintln(msg);
+}
+
+// ------------------------------------------------------------
+// rtc
+
+void loadTimeFromDS3231() {
+  if (!ds3231.begin()) {
+    Serial.println(F("DS3231 not found, waiting for NTP"));
+    rtc.setTime(0, 0, 0, 1, 1, 2020);
+    return;
+  }
+  hasDS3231 = true;
+
+  // DS3231 keeps UTC, the same as the internal clock
+  uint32_t time = ds3231.now().unixtime();
+  if (ds3231.lostPower() || time <= 1577836800) {
+    Serial.println(F("DS3231 time invalid, waiting for NTP"));
+    rtc.setTime(0, 0, 0, 1, 1, 2020);
+    return;
+  }
+
+  rtc.setTime(time);
+  timeIsValid = true;
+  currentStatus = STATUS_READY;
+  Serial.println(F("Time loaded from DS3231"));
 }
 
 // ------------------------------------------------------------
@@ -322,20 +498,23 @@ void checkWiFiConnection() {
     if (!wifiConnected) {
       // WiFi just reconnected
       wifiConnected = true;
-      currentStatus = STATUS_NTP;  // WiFi back, waiting for NTP
+      setStatus(STATUS_NTP);  // WiFi back, waiting for NTP
       serialPrintln(F("WiFi reconnected!"));
       String ipMsg = "IP address: " + WiFi.localIP().toString();
       serialPrintln(ipMsg);
 
       // Trigger immediate NTP sync
       nextTimeSync = 0;
+
+      // Rejoin the sync multicast group on the new connection
+      startClockSync();
     }
   } else {
     if (wifiConnected) {
       // WiFi just disconnected
       wifiConnected = false;
       timeIsSynced = false;
-      currentStatus = STATUS_WIFI;  // Lost WiFi, trying to reconnect
+      setStatus(STATUS_WIFI);  // Lost WiFi, trying to reconnect
       serialPrintln(F("WiFi connection lost! Attempting to reconnect..."));
     }
 
@@ -349,9 +528,32 @@ void onWiFiConnected() {
   String ipMsg = "IP address: " + WiFi.localIP().toString();
   serialPrintln(ipMsg);
 
-  startNTP();
-  startMDNS();
+  // mDNS probing and the first NTP fetch both wait on the network, run them next to the webserver start
+  unsigned long phaseStart = millis();
+  xTaskCreatePinnedToCore(mdnsStartTask, "MdnsStart", 4096, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(ntpStartTask, "NtpStart", 4096, NULL, 1, NULL, 0);
   startServer();
+
+  // Clock sync advertises its role in the mDNS service
+  xEventGroupWaitBits(serviceEvents, SERVICE_MDNS_STARTED, pdFALSE, pdTRUE, portMAX_DELAY);
+  startClockSync();
+  recordBootPhase(BOOT_SERVICES, phaseStart);
+
+  // The network task loop syncs NTP from here on, it must not run next to the first fetch
+  xEventGroupWaitBits(serviceEvents, SERVICE_NTP_FETCHED, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+void mdnsStartTask(void *parameter) {
+  startMDNS();
+  xEventGroupSetBits(serviceEvents, SERVICE_MDNS_STARTED);
+  vTaskDelete(NULL);
+}
+
+void ntpStartTask(void *parameter) {
+  startNTP();
+  updateTime();
+  xEventGroupSetBits(serviceEvents, SERVICE_NTP_FETCHED);
+  vTaskDelete(NULL);
 }
 
 void configModeCallback(WiFiManager *myWiFiManager) {
@@ -360,9 +562,8 @@ void configModeCallback(WiFiManager *myWiFiManager) {
   Serial.println(WiFi.softAPIP());
   Serial.print(F("SSID: "));
   Serial.println(myWiFiManager->getConfigPortalSSID());
-  delay(250);
 
-  currentStatus = STATUS_WIFI;
+  setStatus(STATUS_WIFI);
 }
 
 void wifiSaveCallback() {
@@ -385,8 +586,8 @@ void startNTP() {
   timeClient.setPoolServerName("pool.ntp.org");
   timeClient.setTimeOffset(0);
   timeClient.begin();
-  delay(500);
   nextTimeSync = 0;
+  ntpStartedAt = millis();
   serialPrintln(F("NTP client started, will sync immediately"));
 }
 
@@ -394,7 +595,6 @@ void startMDNS() {
   MDNS.begin(DNS_NAME);
   MDNS.addService("http", "tcp", 80);
   MDNS.addService("wordclock", "tcp", 80);
-  delay(500);
   serialPrintln(F("mDNS responder started"));
 }
 
@@ -402,6 +602,7 @@ void startServer() {
   server.onNotFound(handleNotFound);
   server.on("/", HTTP_GET, handleConnect);
   server.on("/status", HTTP_GET, handleStatus);
+  server.on("/trace", HTTP_GET, handleTrace);
   server.on("/resetwifi", HTTP_POST, handleResetWiFi);
 
   server.onRequestBody([](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
@@ -414,15 +615,17 @@ void startServer() {
 
   events.onConnect([](AsyncEventSourceClient *client) {
     if (client->lastId()) {
-      Serial.printf("SSE Client reconnected! Last message ID: %u\n", client->lastId());
-      Serial.flush();
-      vTaskDelay(1);
+      serialPrint(F("SSE Client reconnected! Last message ID: "));
+      serialPrintln((unsigned long)client->lastId());
     } else {
       serialPrintln(F("SSE Client connected"));
     }
   });
   server.addHandler(&events);
 
+  frameSocket.onEvent(handleFrameSocketEvent);
+  server.addHandler(&frameSocket);
+
   server.serveStatic("/index.html", LittleFS, "/index.html")
     .setCacheControl("max-age=86400");
   server.serveStatic("/app.js", LittleFS, "/app.js")
@@ -431,7 +634,6 @@ void startServer() {
     .setCacheControl("max-age=86400");
 
   server.begin();
-  delay(500);
   serialPrintln(F("WebServer started"));
 }
 
@@ -444,107 +646,138 @@ void handleConnect(AsyncWebServerRequest *request) {
 }
 
 void handleStatus(AsyncWebServerRequest *request) {
-  StaticJsonDocument<256> doc;
-
-  doc["red"] = config.red;
-  doc["green"] = config.green;
-  doc["blue"] = config.blue;
-  doc["brightness"] = config.brightness;
-  doc["language"] = config.language;
-  doc["enabled"] = config.enabled;
-  doc["superBright"] = config.superBright;
-  doc["transition"] = config.transition;
-  doc["prefixMode"] = config.prefixMode;
-  doc["transitionSpeed"] = config.transitionSpeed;
+  trace::Scope scope(trace::EV_HTTP_STATUS);
+
+  webApi::StatusInfo info;
+  info.powerMa = estimatedPowerMa;
+  info.bootPhaseMs = bootPhaseMs;
+  info.bootPhaseNames = BOOT_PHASE_NAMES;
+  info.numBootPhases = NUM_BOOT_PHASES;
+  portENTER_CRITICAL(&colorStatsMux);
+  info.hasColorRender = colorStatsMode != colorModes::MODE_STATIC;
+  info.colorRenderUs = colorRenderUs;
+  info.colorRenderMaxUs = colorRenderMaxUs;
+  info.colorFrameUs = colorFrameUs;
+  portEXIT_CRITICAL(&colorStatsMux);
+  info.colorRenderBudgetUs = COLOR_RENDER_BUDGET_US;
+  info.syncRole = syncRunningRole;
+  portENTER_CRITICAL(&syncMux);
+  info.hasSyncOffset = syncRunningRole == clockSync::ROLE_FOLLOWER && clockSync::hasOffset();
+  info.syncOffsetUs = clockSync::offset();
+  info.syncRoundTripUs = clockSync::roundTrip();
+  portEXIT_CRITICAL(&syncMux);
+  portENTER_CRITICAL(&scheduleMux);
+  info.hasScheduleChange = scheduleNextChange != 0;
+  info.nextScheduleChange = scheduleNextChange;
+  portEXIT_CRITICAL(&scheduleMux);
 
   String response;
-  response.reserve(128);
-  if (!serializeJson(doc, response)) {
-    Serial.println(F("Failed to create response!"));
-  }
-
+  webApi::writeStatus(config, info, response);
   request->send(200, "application/json", response);
-  delay(250);
 }
 
 void handleUpdate(AsyncWebServerRequest *request, uint8_t *data, size_t len) {
-  StaticJsonDocument<512> doc;
-  DeserializationError error = deserializeJson(doc, data, len);
+  trace::Scope scope(trace::EV_HTTP_UPDATE);
+
+  webApi::UpdateResult result = webApi::applyUpdate(data, len, config, colorModes::NUM_MODES);
 
-  if (error) {
-    Serial.println(F("Failed to deserialize json from update-request."));
-    Serial.println(error.c_str());
+  if (!result.valid) {
+    serialPrintln(F("Failed to deserialize json from update-request."));
+    serialPrintln(result.error);
     request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
     return;
   }
 
-  if (doc.containsKey("red") || doc.containsKey("green") || doc.containsKey("blue")) {
-    if (doc.containsKey("red"))
-      config.red = (uint8_t)doc["red"];
-    if (doc.containsKey("green"))
-      config.green = (uint8_t)doc["green"];
-    if (doc.containsKey("blue"))
-      config.blue = (uint8_t)doc["blue"];
+  if (result.preview && currentStatus == STATUS_READY) {
+    playPreviewAnimation = true;
+  }
+
+  // Repeated values, e.g. from a slider drag, neither rewrite NVS nor re-render
+  if (result.changes) {
+    printChanges(result.changes);
+    keepManualSettings(result.changes);
+    if (result.changes & webApi::CHANGE_SCHEDULE) {
+      queueSchedule();
+    }
+    update = true;
+    storeSettings();
+    broadcastSettings();
+  }
+
+  request->send(200, "text/plain", "ok");
+}
+
+void printChanges(uint16_t changes) {
+  if (changes & webApi::CHANGE_COLOR) {
     String msg = "RGB: " + String(config.red) + "/" + String(config.green) + "/" + String(config.blue);
     serialPrintln(msg);
   }
-  if (doc.containsKey("brightness")) {
-    config.brightness = (uint8_t)doc["brightness"];
+  if (changes & webApi::CHANGE_BRIGHTNESS) {
     String msg = "Brightness: " + String(config.brightness) + "/255";
     serialPrintln(msg);
   }
-  if (doc.containsKey("language")) {
-    config.language = String(doc["language"]);
+  if (changes & webApi::CHANGE_LANGUAGE) {
     String msg = "Language: " + config.language;
     serialPrintln(msg);
   }
-  if (doc.containsKey("enabled")) {
-    config.enabled = doc["enabled"];
+  if (changes & webApi::CHANGE_ENABLED) {
     String msg = "Enabled: " + String(config.enabled);
     serialPrintln(msg);
   }
-  if (doc.containsKey("superBright")) {
-    config.superBright = doc["superBright"];
+  if (changes & webApi::CHANGE_SUPERBRIGHT) {
     String msg = "SuperBright: " + String(config.superBright);
     serialPrintln(msg);
   }
-  if (doc.containsKey("transition")) {
-    uint8_t newTransition = (uint8_t)doc["transition"];
-    bool transitionChanged = (config.transition != newTransition);
-    config.transition = newTransition;
+  if (changes & webApi::CHANGE_TRANSITION) {
     String msg = "Transition: " + String(config.transition);
     serialPrintln(msg);
-
-    if (currentStatus == STATUS_READY) {
-      if (transitionChanged) {
-        playPreviewAnimation = true;
-      } else if (doc.containsKey("forcePreview") && doc["forcePreview"]) {
-        playPreviewAnimation = true;
-      }
-    }
   }
-  if (doc.containsKey("prefixMode")) {
-    config.prefixMode = (uint8_t)doc["prefixMode"];
+  if (changes & webApi::CHANGE_PREFIX_MODE) {
     String msg = "PrefixMode: " + String(config.prefixMode);
     serialPrintln(msg);
   }
-  if (doc.containsKey("transitionSpeed")) {
-    config.transitionSpeed = (uint8_t)doc["transitionSpeed"];
+  if (changes & webApi::CHANGE_TRANSITION_SPEED) {
     String msg = "Speed: " + String(config.transitionSpeed);
     serialPrintln(msg);
   }
+  if (changes & webApi::CHANGE_SYNC_MODE) {
+    String msg = "SyncMode: " + String(config.syncMode);  // Network task restarts sync on change
+    serialPrintln(msg);
+  }
+  if (changes & webApi::CHANGE_POWER_BUDGET) {
+    String msg = "PowerBudget: " + String(config.powerBudget) + " mA";
+    serialPrintln(msg);
+  }
+  if (changes & webApi::CHANGE_COLOR_MODE) {
+    String msg = "ColorMode: " + String(config.colorMode);
+    serialPrintln(msg);
+  }
+  if (changes & webApi::CHANGE_SCHEDULE) {
+    String msg = "Schedule: " + String(config.numRules) + " rules";
+    serialPrintln(msg);
+  }
+}
 
-  update = true;
-
-  storeSettings();
-  broadcastSettings();
+// Chrome trace_event JSON of the trace ring, open in chrome://tracing or ui.perfetto.dev
+void handleTrace(AsyncWebServerRequest *request) {
+  uint32_t exportId = trace::startExport();
+  if (!exportId) {
+    request->send(503, "text/plain", "Trace export already running");
+    return;
+  }
 
-  request->send(200, "text/plain", "ok");
-  delay(250);
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/json", [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    return trace::readExport(buffer, maxLen);
+  });
+  response->addHeader("Content-Disposition", "attachment; filename=\"wordclock-trace.json\"");
+  request->onDisconnect([exportId]() {
+    trace::cancelExport(exportId);  // Client went away before the end
+  });
+  request->send(response);
 }
 
 void handleResetWiFi(AsyncWebServerRequest *request) {
-  Serial.println(F("WiFi reset requested via web interface"));
+  serialPrintln(F("WiFi reset requested via web interface"));
   request->send(200, "text/plain", "WiFi settings will be reset. Device restarting...");
 
   delay(1000);
@@ -577,57 +810,452 @@ void loadSettings() {
 
   // Load transition speed with validation
   uint8_t loadedSpeed = preferences.getUChar("transSpeed", 2);
-  if (loadedSpeed > 4) {
+  if (loadedSpeed > TRANSITION_SPEED_MAX) {
     config.transitionSpeed = 2;  // Invalid value, use default (medium)
   } else {
     config.transitionSpeed = loadedSpeed;
   }
 
+  // Load sync mode with validation
+  uint8_t loadedSyncMode = preferences.getUChar("syncMode", clockSync::ROLE_OFF);
+  if (loadedSyncMode > clockSync::ROLE_FOLLOWER) {
+    config.syncMode = clockSync::ROLE_OFF;  // Invalid value, use default
+  } else {
+    config.syncMode = loadedSyncMode;
+  }
+
+  config.powerBudget = constrain(preferences.getUShort("powerBudget", 800), POWER_BUDGET_MIN, POWER_BUDGET_MAX);
+
+  // Load colour mode with validation
+  uint8_t loadedColorMode = preferences.getUChar("colorMode", colorModes::MODE_STATIC);
+  if (loadedColorMode >= colorModes::NUM_MODES) {
+    config.colorMode = colorModes::MODE_STATIC;  // Invalid value, use default
+  } else {
+    config.colorMode = loadedColorMode;
+  }
+
+  // Load schedule with validation, stored as raw rules
+  config.numRules = 0;
+  size_t scheduleBytes = preferences.getBytesLength("schedule");
+  if (scheduleBytes > 0 && scheduleBytes <= sizeof(config.rules) && scheduleBytes % sizeof(schedule::Rule) == 0) {
+    schedule::Rule loadedRules[schedule::MAX_RULES];
+    preferences.getBytes("schedule", loadedRules, scheduleBytes);
+    for (uint8_t i = 0; i < scheduleBytes / sizeof(schedule::Rule); i++) {
+      if (schedule::isValid(loadedRules[i]) && loadedRules[i].transition <= TRANSITION_SPARKLE) {
+        config.rules[config.numRules++] = loadedRules[i];  // Invalid rules are dropped
+      }
+    }
+  }
+
   preferences.end();
 
-  delay(250);
+  keepManualSettings(0xFFFF);
+  queueSchedule();
+
   Serial.println(F("Settings loaded from preferences"));
   printSettings();
 }
 
 void storeSettings() {
+  trace::Scope scope(trace::EV_NVS_WRITE);
+
   preferences.begin(PREFS_NAMESPACE, false);
 
-  preferences.putUChar("red", config.red);
-  preferences.putUChar("green", config.green);
-  preferences.putUChar("blue", config.blue);
-  preferences.putUChar("brightness", config.brightness);
+  // Manual values, a scheduled override is not persisted
+  preferences.putUChar("red", manualSettings.red);
+  preferences.putUChar("green", manualSettings.green);
+  preferences.putUChar("blue", manualSettings.blue);
+  preferences.putUChar("brightness", manualSettings.brightness);
   preferences.putString("language", config.language);
-  preferences.putBool("enabled", config.enabled);
+  preferences.putBool("enabled", manualSettings.enabled);
   preferences.putBool("superBright", config.superBright);
-  preferences.putUChar("transition", config.transition);
+  preferences.putUChar("transition", manualSettings.transition);
   preferences.putUChar("prefixMode", config.prefixMode);
   preferences.putUChar("transSpeed", config.transitionSpeed);
+  preferences.putUChar("syncMode", config.syncMode);
+  preferences.putUShort("powerBudget", config.powerBudget);
+  preferences.putUChar("colorMode", config.colorMode);
+  if (config.numRules > 0) {
+    preferences.putBytes("schedule", config.rules, config.numRules * sizeof(schedule::Rule));
+  } else {
+    preferences.remove("schedule");
+  }
 
   preferences.end();
 }
 
 void broadcastSettings() {
-  StaticJsonDocument<256> doc;
-
-  doc["red"] = config.red;
-  doc["green"] = config.green;
-  doc["blue"] = config.blue;
-  doc["brightness"] = config.brightness;
-  doc["language"] = config.language;
-  doc["enabled"] = config.enabled;
-  doc["superBright"] = config.superBright;
-  doc["transition"] = config.transition;
-  doc["prefixMode"] = config.prefixMode;
-  doc["transitionSpeed"] = config.transitionSpeed;
-
+  // Serialized once, however many SSE clients are connected
   String response;
-  response.reserve(128);
-  serializeJson(doc, response);
+  webApi::writeSettings(config, response);
 
   events.send(response.c_str(), "settings", millis());
 }
 
+// ------------------------------------------------------------
+// live mirror
+
+// Runs in the AsyncTCP task, the library frees the client right after the disconnect event
+void handleFrameSocketEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    server->cleanupClients();  // Drop closed clients here, on the task that owns the client list
+
+    bool accepted = false;
+    xSemaphoreTake(frameLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < FRAME_CLIENTS; i++) {
+      if (frameClients[i].client == nullptr) {
+        frameClients[i].client = client;
+        frameClients[i].id = client->id();
+        frameClients[i].hasFrame = false;
+        frameClients[i].lastSent = 0;
+        frameViewers++;
+        accepted = true;
+        break;
+      }
+    }
+    xSemaphoreGive(frameLock);
+
+    if (!accepted) {
+      client->close();
+      serialPrintln(F("Mirror client rejected, too many viewers"));
+    } else {
+      serialPrintln(F("Mirror client connected"));
+    }
+  } else if (type == WS_EVT_DISCONNECT) {
+    xSemaphoreTake(frameLock, portMAX_DELAY);
+    for (uint8_t i = 0; i < FRAME_CLIENTS; i++) {
+      if (frameClients[i].client == client) {
+        frameClients[i].client = nullptr;
+        frameViewers--;
+      }
+    }
+    xSemaphoreGive(frameLock);
+  }
+}
+
+// Every frame goes through here: the current limiter and the mirror see exactly what the LEDs show
+void showFrame() {
+  uint8_t *pixels = strip.getPixels();
+  uint32_t idle = (uint32_t)LED_MODEL.idle * NUM_LEDS;
+  uint32_t estimate = powerModel::estimateGRB(pixels, NUM_LEDS, LED_MODEL);
+  powerScale = powerModel::step(estimate, idle, (uint32_t)config.powerBudget * 1000, powerScale, POWER_RELEASE_STEP);
+  estimatedPowerMa = (powerModel::scaledEstimate(estimate, idle, powerScale) + 999) / 1000;
+
+  if (powerScale < 256) {
+    // Scale a copy, the strip buffer keeps the unlimited frame for the next brightness change
+    static uint8_t unlimited[NUM_LEDS * 3];
+    memcpy(unlimited, pixels, sizeof(unlimited));
+    powerModel::scalePixels(pixels, sizeof(unlimited), powerScale);
+    trace::begin(trace::EV_SHOW);
+    strip.show();
+    trace::end(trace::EV_SHOW);
+    memcpy(pixels, unlimited, sizeof(unlimited));
+  } else {
+    trace::begin(trace::EV_SHOW);
+    strip.show();
+    trace::end(trace::EV_SHOW);
+  }
+
+  publishFrame();
+}
+
+// Copies the strip buffer (brightness and current limit applied) as RGB
+void captureFrame(uint8_t *rgb) {
+  const uint8_t *pixels = strip.getPixels();  // GRB order
+  for (uint16_t i = 0; i < NUM_LEDS; i++) {
+    rgb[i * 3] = pixels[i * 3 + 1];
+    rgb[i * 3 + 1] = pixels[i * 3];
+    rgb[i * 3 + 2] = pixels[i * 3 + 2];
+  }
+  powerModel::scalePixels(rgb, NUM_LEDS * 3, powerScale);
+}
+
+// Runs on the display task after every show(). The lock only covers picking the viewers,
+// sending goes through frameSocket by id so connects and disconnects never wait for it
+void publishFrame() {
+  if (frameViewers == 0) {
+    return;  // Nobody watching
+  }
+  trace::Scope scope(trace::EV_MIRROR);
+
+  static uint8_t rgb[NUM_LEDS * 3];
+  static uint8_t encoded[frameStream::maxFrameSize(NUM_LEDS)];
+  uint8_t dueSlots[FRAME_CLIENTS];
+  uint32_t dueIds[FRAME_CLIENTS];
+  bool dueHasFrame[FRAME_CLIENTS];
+  uint8_t numDue = 0;
+  unsigned long now = millis();
+
+  xSemaphoreTake(frameLock, portMAX_DELAY);
+  for (uint8_t i = 0; i < FRAME_CLIENTS; i++) {
+    FrameClient &slot = frameClients[i];
+    if (slot.client == nullptr || now - slot.lastSent < FRAME_MIN_INTERVAL) {
+      continue;
+    }
+
+    // Slow viewer: drop the frame while the last one is still queued, the next one is a delta against what it already has
+    if (slot.client->status() != WS_CONNECTED || slot.client->queueLen() > 0) {
+      continue;
+    }
+
+    dueSlots[numDue] = i;
+    dueIds[numDue] = slot.id;
+    dueHasFrame[numDue] = slot.hasFrame;
+    numDue++;
+  }
+  xSemaphoreGive(frameLock);
+
+  if (numDue == 0) {
+    return;
+  }
+  captureFrame(rgb);
+
+  for (uint8_t n = 0; n < numDue; n++) {
+    FrameClient &slot = frameClients[dueSlots[n]];
+    size_t len = 0;
+    if (dueHasFrame[n]) {
+      len = frameStream::encodeDelta(slot.frame, rgb, NUM_LEDS, encoded, sizeof(encoded));
+      if (len == 0 && memcmp(slot.frame, rgb, sizeof(rgb)) == 0) {
+        continue;  // Unchanged
+      }
+    }
+    if (len == 0) {
+      len = frameStream::encodeKeyframe(rgb, NUM_LEDS, encoded, sizeof(encoded));
+    }
+
+    frameSocket.binary(dueIds[n], encoded, len);  // No-op if the viewer left meanwhile
+
+    // A viewer that took over the slot meanwhile starts with a keyframe, leave it alone
+    xSemaphoreTake(frameLock, portMAX_DELAY);
+    if (slot.client != nullptr && slot.id == dueIds[n]) {
+      memcpy(slot.frame, rgb, sizeof(rgb));
+      slot.lastSent = now;
+      slot.hasFrame = true;
+    }
+    xSemaphoreGive(frameLock);
+  }
+}
+
+// ------------------------------------------------------------
+// multi-clock sync
+
+int64_t localMicros() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// Clock used for display: the leader's clock on followers, the local clock otherwise
+int64_t clockMicros() {
+  int64_t now = localMicros();
+  if (syncRunningRole == clockSync::ROLE_FOLLOWER) {
+    portENTER_CRITICAL(&syncMux);
+    now += clockSync::offset();
+    portEXIT_CRITICAL(&syncMux);
+  }
+  return now;
+}
+
+time_t currentEpoch() {
+  return clockMicros() / 1000000LL;
+}
+
+// Leader's next minute transition on followers, 0 if the local clock decides
+int64_t announcedTransition() {
+  int64_t announced = 0;
+  if (syncRunningRole == clockSync::ROLE_FOLLOWER) {
+    portENTER_CRITICAL(&syncMux);
+    announced = syncTransitionStart;
+    portEXIT_CRITICAL(&syncMux);
+  }
+  return announced;
+}
+
+void resetClockSyncOffset() {
+  portENTER_CRITICAL(&syncMux);
+  clockSync::resetEstimator();
+  portEXIT_CRITICAL(&syncMux);
+}
+
+void shiftClockSyncOffset(int64_t step) {
+  portENTER_CRITICAL(&syncMux);
+  clockSync::shiftLocalClock(step);
+  portEXIT_CRITICAL(&syncMux);
+}
+
+const char *syncRoleName(uint8_t role) {
+  switch (role) {
+    case clockSync::ROLE_LEADER:
+      return "leader";
+    case clockSync::ROLE_FOLLOWER:
+      return "follower";
+    default:
+      return "off";
+  }
+}
+
+void startClockSync() {
+  syncUDP.close();
+  resetClockSyncOffset();
+  portENTER_CRITICAL(&syncMux);
+  syncLeaderKnown = false;
+  syncUnanswered = 0;
+  syncTransitionStart = 0;
+  portEXIT_CRITICAL(&syncMux);
+  syncStartedMode = config.syncMode;
+  syncRunningRole = config.syncMode;
+
+  // Followers find the leader through the wordclock mDNS service
+  MDNS.addServiceTxt("wordclock", "tcp", "sync", syncRoleName(syncRunningRole));
+
+  if (syncRunningRole == clockSync::ROLE_OFF) {
+    return;
+  }
+
+  if (!syncUDP.listenMulticast(SYNC_MULTICAST_IP, clockSync::PORT)) {
+    serialPrintln(F("Clock sync socket failed"));
+    syncRunningRole = clockSync::ROLE_OFF;
+    return;
+  }
+  syncUDP.onPacket(handleSyncPacket);
+
+  lastSyncDiscovery = millis() - SYNC_DISCOVERY_INTERVAL;  // Discover immediately
+  String msg = "Clock sync started as " + String(syncRoleName(syncRunningRole));
+  serialPrintln(msg);
+}
+
+void sendSyncPacket(const clockSync::Packet &packet, const IPAddress &ip, uint16_t port) {
+  uint8_t buffer[clockSync::PACKET_SIZE];
+  size_t len = clockSync::encodePacket(packet, buffer, sizeof(buffer));
+  syncUDP.writeTo(buffer, len, ip, port);
+}
+
+// Runs in the AsyncUDP task, so timestamps are taken as close to the wire as possible
+void handleSyncPacket(AsyncUDPPacket &packet) {
+  int64_t received = localMicros();
+
+  clockSync::Packet in;
+  if (!clockSync::decodePacket(packet.data(), packet.length(), in)) {
+    return;
+  }
+
+  if (syncRunningRole == clockSync::ROLE_LEADER && in.type == clockSync::PACKET_REQUEST) {
+    if (!timeIsSynced) {
+      return;  // Followers keep their own clock until this one is set by NTP
+    }
+    clockSync::Packet out;
+    clockSync::makeResponse(in, received, localMicros(), syncClockEpoch, out);
+    sendSyncPacket(out, packet.remoteIP(), packet.remotePort());
+    return;
+  }
+
+  if (syncRunningRole != clockSync::ROLE_FOLLOWER) {
+    return;
+  }
+
+  portENTER_CRITICAL(&syncMux);
+  if (in.type == clockSync::PACKET_RESPONSE) {
+    if (clockSync::acceptResponse(in, received)) {
+      syncTransitionStart = in.transitionStart;
+      syncUnanswered = 0;
+    }
+  } else if (in.type == clockSync::PACKET_ANNOUNCE) {
+    if (!syncLeaderKnown) {
+      syncLeaderIP = packet.remoteIP();  // Fallback if mDNS discovery failed
+      syncLeaderKnown = true;
+    }
+    syncTransitionStart = in.transitionStart;
+  }
+  portEXIT_CRITICAL(&syncMux);
+}
+
+void discoverClockSyncLeader() {
+  unsigned long now = millis();
+  if (now - lastSyncDiscovery < SYNC_DISCOVERY_INTERVAL) {
+    return;
+  }
+  lastSyncDiscovery = now;
+
+  int found = MDNS.queryService("wordclock", "tcp");
+  for (int i = 0; i < found; i++) {
+    if (MDNS.hasTxt(i, "sync") && MDNS.txt(i, "sync") == "leader") {
+      IPAddress leader = MDNS.IP(i);
+      portENTER_CRITICAL(&syncMux);
+      syncLeaderIP = leader;
+      syncLeaderKnown = true;
+      syncUnanswered = 0;
+      portEXIT_CRITICAL(&syncMux);
+
+      String msg = "Clock sync leader: " + leader.toString();
+      serialPrintln(msg);
+      return;
+    }
+  }
+}
+
+// Called from the network task once per second
+void updateClockSync() {
+  if (config.syncMode != syncStartedMode) {
+    startClockSync();
+  }
+
+  if (syncRunningRole == clockSync::ROLE_OFF || !wifiConnected) {
+    return;
+  }
+
+  clockSync::Packet packet;
+  uint32_t sequence = ++syncSequence;
+
+  if (syncRunningRole == clockSync::ROLE_LEADER) {
+    // Only lead with a clock that has been set by NTP
+    if (!timeIsSynced) {
+      return;
+    }
+    clockSync::makeAnnounce(localMicros(), syncClockEpoch, packet);
+    sendSyncPacket(packet, SYNC_MULTICAST_IP, clockSync::PORT);
+    return;
+  }
+
+  // A leader that stops answering was rebooted or switched off, fall back to the local clock
+  portENTER_CRITICAL(&syncMux);
+  bool leaderLost = syncLeaderKnown && syncUnanswered >= SYNC_LEADER_TIMEOUT;
+  if (leaderLost) {
+    syncLeaderKnown = false;
+    syncUnanswered = 0;
+    syncTransitionStart = 0;
+    clockSync::resetEstimator();
+  } else if (syncLeaderKnown) {
+    syncUnanswered++;
+  }
+  bool leaderKnown = syncLeaderKnown;
+  IPAddress leader = syncLeaderIP;
+  bool hasOffset = clockSync::hasOffset();
+  int64_t offset = clockSync::offset();
+  int64_t roundTrip = clockSync::roundTrip();
+  portEXIT_CRITICAL(&syncMux);
+
+  if (leaderLost) {
+    serialPrintln(F("Clock sync leader lost, searching again"));
+    lastSyncDiscovery = millis() - SYNC_DISCOVERY_INTERVAL;  // Discover right away
+  }
+
+  if (!leaderKnown) {
+    discoverClockSyncLeader();
+    return;
+  }
+
+  if (hasOffset && sequence % SYNC_REPORT_INTERVAL == 0) {
+    String msg = "Clock sync offset: " + String((long)offset) + " us, round trip: " + String((long)roundTrip) + " us";
+    serialPrintln(msg);
+  }
+
+  int64_t originate = localMicros();
+  portENTER_CRITICAL(&syncMux);
+  clockSync::makeRequest(sequence, originate, packet);  // Answers to older requests are dropped from now on
+  portEXIT_CRITICAL(&syncMux);
+  sendSyncPacket(packet, leader, clockSync::PORT);
+}
+
 // ------------------------------------------------------------
 // wordclock logic
 
@@ -673,11 +1301,11 @@ void getTransitionDelays(int &fadeDelay, int &wipeDelay, int &sparkleDelay, int
 void fadeOut(int fadeDelay) {
   for (int brightness = config.brightness; brightness >= 0; brightness -= 8) {
     strip.setBrightness(brightness);
-    strip.show();
+    showFrame();
     delay(fadeDelay);
   }
   strip.clear();
-  strip.show();
+  showFrame();
 }
 
 void fadeIn(uint32_t *colors, int fadeDelay) {
@@ -686,7 +1314,7 @@ void fadeIn(uint32_t *colors, int fadeDelay) {
     for (int i = 0; i < NUM_LEDS; i++) {
       strip.setPixelColor(i, colors[i]);
     }
-    strip.show();
+    showFrame();
     delay(fadeDelay);
   }
 
@@ -695,7 +1323,7 @@ void fadeIn(uint32_t *colors, int fadeDelay) {
   for (int i = 0; i < NUM_LEDS; i++) {
     strip.setPixelColor(i, colors[i]);
   }
-  strip.show();
+  showFrame();
 }
 
 // Transition animation functions
@@ -728,11 +1356,11 @@ void wipeTransition(time_t time, String *timeString) {
   for (int i = 0; i < NUM_LEDS; i++) {
     strip.setPixelColor(i, 0, 0, 0);
     if (i % 3 == 0) {
-      strip.show();
+      showFrame();
       delay(wipeDelay);
     }
   }
-  strip.show();
+  showFrame();
 
   strip.clear();
   setPixels(time, timeString);
@@ -743,18 +1371,18 @@ void wipeTransition(time_t time, String *timeString) {
   }
 
   strip.clear();
-  strip.show();
+  showFrame();
 
   for (int i = 0; i < NUM_LEDS; i++) {
     strip.setPixelColor(i, tempColors[i]);
     if (i % 3 == 0) {
-      strip.show();
+      showFrame();
       delay(wipeDelay);
     }
   }
 
   strip.setBrightness(config.brightness);
-  strip.show();
+  showFrame();
 }
 
 void sparkleTransition(time_t time, String *timeString) {
@@ -775,12 +1403,12 @@ void sparkleTransition(time_t time, String *timeString) {
       ledsRemaining--;
 
       if (ledsRemaining % 5 == 0) {
-        strip.show();
+        showFrame();
         delay(sparkleDelay);
       }
     }
   }
-  strip.show();
+  showFrame();
 
   strip.clear();
   setPixels(time, timeString);
@@ -792,7 +1420,7 @@ void sparkleTransition(time_t time, String *timeString) {
   }
 
   strip.clear();
-  strip.show();
+  showFrame();
 
   ledsRemaining = NUM_LEDS;
   while (ledsRemaining > 0) {
@@ -803,23 +1431,25 @@ void sparkleTransition(time_t time, String *timeString) {
       ledsRemaining--;
 
       if (ledsRemaining % 5 == 0) {
-        strip.show();
+        showFrame();
         delay(sparkleDelay);
       }
     }
   }
 
   strip.setBrightness(config.brightness);
-  strip.show();
+  showFrame();
 }
 
 void playTransition(time_t time, String *timeString) {
+  trace::Scope scope(trace::EV_TRANSITION);
+
   switch (config.transition) {
     case TRANSITION_NONE:
       // No animation, just update directly
       strip.clear();
       setPixels(time, timeString);
-      strip.show();
+      showFrame();
       break;
 
     case TRANSITION_FADE:
@@ -838,7 +1468,7 @@ void playTransition(time_t time, String *timeString) {
       // Unknown transition, fall back to no animation
       strip.clear();
       setPixels(time, timeString);
-      strip.show();
+      showFrame();
       break;
   }
 }
@@ -851,6 +1481,7 @@ void refreshMatrix(bool settingsChanged) {
 
   // Handle power OFF - simple fade out regardless of transition type
   if (!config.enabled && wasEnabled) {
+    trace::Scope scope(trace::EV_TRANSITION);
     int fadeDelay, wipeDelay, sparkleDelay, pauseDelay;
     getTransitionDelays(fadeDelay, wipeDelay, sparkleDelay, pauseDelay);
     fadeOut(fadeDelay);
@@ -860,7 +1491,7 @@ void refreshMatrix(bool settingsChanged) {
 
   if (!config.enabled) {
     strip.clear();
-    strip.show();
+    showFrame();
     return;
   }
 
@@ -869,7 +1500,7 @@ void refreshMatrix(bool settingsChanged) {
     wasEnabled = true;
 
     if (currentStatus == STATUS_READY) {
-      time_t timeUTC = rtc.getEpoch();
+      time_t timeUTC = currentEpoch();
       time_t time = AT.toLocal(timeUTC);
       String timeString;
 
@@ -891,7 +1522,6 @@ void refreshMatrix(bool settingsChanged) {
       lastBrightness = config.brightness;
       lastSuperBright = config.superBright;
       serialPrintln(timeString);
-      update = false;
       return;
     }
 
@@ -904,7 +1534,7 @@ void refreshMatrix(bool settingsChanged) {
     return;
   }
 
-  time_t timeUTC = rtc.getEpoch();
+  time_t timeUTC = currentEpoch();
   time_t time = AT.toLocal(timeUTC);
   uint8_t currentMin = minute(time);
 
@@ -914,7 +1544,9 @@ void refreshMatrix(bool settingsChanged) {
     String timeString;
     strip.setBrightness(applySuperBrightCap(config.brightness));
     playTransition(time, &timeString);
-    Serial.println(F("Preview animation played"));
+    lastBrightness = config.brightness;
+    lastSuperBright = config.superBright;
+    serialPrintln(F("Preview animation played"));
     return;
   }
 
@@ -924,15 +1556,24 @@ void refreshMatrix(bool settingsChanged) {
     strip.setBrightness(applySuperBrightCap(config.brightness));
     strip.clear();
     setPixels(time, &timeString);
-    strip.show();
+    showFrame();
     lastMin = currentMin;
     serialPrintln(timeString);
     firstDisplay = false;
+    if (bootPhaseMs[BOOT_FIRST_FRAME] < 0) {
+      recordBootPhase(BOOT_FIRST_FRAME, 0);
+    }
     return;
   }
 
   // Handle brightness or superbright change with smooth rolling transition
   if (settingsChanged && (config.brightness != lastBrightness || config.superBright != lastSuperBright)) {
+    trace::Scope scope(trace::EV_TRANSITION);
+
+    // Redraw first, a scheduled rule may change the colour together with the brightness
+    strip.clear();
+    setPixels(time, nullptr);
+
     // Smooth rolling brightness change in steps of 20
     uint8_t targetBrightness = applySuperBrightCap(config.brightness);
     uint8_t lastActualBrightness = applySuperBrightCap(lastBrightness);
@@ -950,17 +1591,16 @@ void refreshMatrix(bool settingsChanged) {
       }
 
       strip.setBrightness(currentBrightness);
-      strip.show();
+      showFrame();
       delay(30);  // Delay between brightness steps
     }
 
     // Final brightness
     strip.setBrightness(applySuperBrightCap(config.brightness));
-    strip.show();
+    showFrame();
 
     lastBrightness = config.brightness;
     lastSuperBright = config.superBright;
-    update = false;  // Clear update flag after processing brightness change
     return;
   }
 
@@ -977,8 +1617,7 @@ void refreshMatrix(bool settingsChanged) {
     strip.setBrightness(applySuperBrightCap(config.brightness));
     strip.clear();
     setPixels(time, nullptr);  // Don't build string for settings-only changes
-    strip.show();
-    update = false;  // Clear update flag after processing settings change
+    showFrame();
   }
 }
 
@@ -1041,18 +1680,181 @@ void showStatusAnimation() {
       strip.setPixelColor(MINUTE_LEDS[2], r, g, b);
     }
 
-    strip.show();
+    showFrame();
     lastUpdate = now;
   }
 }
 
 void setPixels(time_t time, String *timeString) {
+  trace::Scope scope(trace::EV_RENDER);
+  clearWords();
+
   if (config.language == "dialekt") {
     dialekt::timeToLeds(time, &strip, config.red, config.green, config.blue, config.prefixMode, timeString);
   }
   if (config.language == "deutsch") {
     deutsch::timeToLeds(time, &strip, config.red, config.green, config.blue, config.prefixMode, timeString);
   }
+
+  // Transitions work on a snapshot of the animated colours
+  const WordSpan *words;
+  uint8_t numWords = getWords(&words);
+  colorModes::render(config.colorMode, &strip, words, numWords, millis(), config.red, config.green, config.blue);
+}
+
+// Redraws the lit words of an animated colour mode, called once per frame from the display task
+void renderColorFrame() {
+  unsigned long start = micros();
+  trace::begin(trace::EV_RENDER);
+  const WordSpan *words;
+  uint8_t numWords = getWords(&words);
+  colorModes::render(config.colorMode, &strip, words, numWords, millis(), config.red, config.green, config.blue);
+  trace::end(trace::EV_RENDER);
+  unsigned long renderUs = micros() - start;
+
+  showFrame();
+  unsigned long frameUs = micros() - start;
+
+  // Published together so /status never mixes two frames or two modes
+  portENTER_CRITICAL(&colorStatsMux);
+  if (colorStatsMode != config.colorMode) {
+    colorStatsMode = config.colorMode;
+    colorRenderMaxUs = 0;
+  }
+  bool newMax = renderUs > colorRenderMaxUs;
+  colorRenderUs = renderUs;
+  colorFrameUs = frameUs;
+  if (newMax) {
+    colorRenderMaxUs = renderUs;
+  }
+  portEXIT_CRITICAL(&colorStatsMux);
+
+  if (newMax && renderUs > COLOR_RENDER_BUDGET_US) {
+    String msg = "ColorMode " + String(config.colorMode) + " over budget: " + String(renderUs) + " us";
+    serialPrintln(msg);
+  }
+}
+
+// ------------------------------------------------------------
+// display schedule
+
+time_t toLocalTime(time_t utc) {
+  return AT.toLocal(utc);
+}
+
+// Applies due change points, called every display tick but only compares against the next one.
+// Returns true if the matrix has to be redrawn
+bool updateSchedule() {
+  static time_t publishedChange = 0;
+
+  if (!timeIsValid) {
+    return false;  // Local time unknown, rules would fire at the wrong time
+  }
+
+  time_t now = currentEpoch();
+  if (scheduleChanged || !timetableCompiled) {
+    compileSchedule(now);
+  }
+
+  time_t compiledDay = timetable.dayStart;
+  uint8_t first = schedule::due(scheduleRules, scheduleNumRules, now, toLocalTime, timetable);
+  if (timetable.dayStart != compiledDay) {
+    printScheduleCompiled();
+  }
+
+  uint16_t changes = 0;
+  for (uint8_t i = first; i < timetable.next; i++) {
+    changes |= applyScheduleRule(scheduleRules[timetable.points[i].rule]);
+  }
+
+  time_t nextChange = scheduleNumRules > 0 ? schedule::nextChange(timetable) : 0;
+  if (nextChange != publishedChange) {
+    portENTER_CRITICAL(&scheduleMux);
+    scheduleNextChange = nextChange;
+    portEXIT_CRITICAL(&scheduleMux);
+    publishedChange = nextChange;
+  }
+
+  // Scheduled changes stay in RAM, NVS keeps the settings made by hand
+  if (changes) {
+    printChanges(changes);
+    settingsBroadcastPending = true;
+  }
+  return (changes & ~webApi::CHANGE_TRANSITION) != 0;  // Transition type alone does not need a redraw
+}
+
+// Hands the rules in config over to the display task, which recompiles on its next tick
+void queueSchedule() {
+  portENTER_CRITICAL(&scheduleMux);
+  pendingNumRules = config.numRules;
+  memcpy(pendingRules, config.rules, pendingNumRules * sizeof(schedule::Rule));
+  scheduleChanged = true;
+  portEXIT_CRITICAL(&scheduleMux);
+}
+
+// Records the settings a request changed by hand, the values storeSettings() persists
+void keepManualSettings(uint16_t changes) {
+  if (changes & webApi::CHANGE_COLOR) {
+    manualSettings.red = config.red;
+    manualSettings.green = config.green;
+    manualSettings.blue = config.blue;
+  }
+  if (changes & webApi::CHANGE_BRIGHTNESS) {
+    manualSettings.brightness = config.brightness;
+  }
+  if (changes & webApi::CHANGE_ENABLED) {
+    manualSettings.enabled = config.enabled;
+  }
+  if (changes & webApi::CHANGE_TRANSITION) {
+    manualSettings.transition = config.transition;
+  }
+}
+
+// Compiles the rules handed over for the current day, carried in rules are due at once
+void compileSchedule(time_t now) {
+  // config.rules belongs to the AsyncTCP task, the display task only sees the copy handed over
+  portENTER_CRITICAL(&scheduleMux);
+  scheduleChanged = false;
+  scheduleNumRules = pendingNumRules;
+  memcpy(scheduleRules, pendingRules, scheduleNumRules * sizeof(schedule::Rule));
+  portEXIT_CRITICAL(&scheduleMux);
+
+  schedule::compile(scheduleRules, scheduleNumRules, now, toLocalTime, timetable);
+  timetableCompiled = true;
+  printScheduleCompiled();
+}
+
+void printScheduleCompiled() {
+  if (scheduleNumRules > 0) {
+    String msg = "Schedule compiled: " + String(timetable.numPoints - timetable.next) + " change points left today";
+    serialPrintln(msg);
+  }
+}
+
+// Returns the settings the rule actually changed as webApi::Change bits
+uint16_t applyScheduleRule(const schedule::Rule &rule) {
+  uint16_t changes = 0;
+
+  if ((rule.fields & schedule::FIELD_BRIGHTNESS) && config.brightness != rule.brightness) {
+    config.brightness = rule.brightness;
+    changes |= webApi::CHANGE_BRIGHTNESS;
+  }
+  if ((rule.fields & schedule::FIELD_COLOR) && (config.red != rule.red || config.green != rule.green || config.blue != rule.blue)) {
+    config.red = rule.red;
+    config.green = rule.green;
+    config.blue = rule.blue;
+    changes |= webApi::CHANGE_COLOR;
+  }
+  if ((rule.fields & schedule::FIELD_POWER) && config.enabled != (bool)rule.enabled) {
+    config.enabled = rule.enabled;
+    changes |= webApi::CHANGE_ENABLED;
+  }
+  if ((rule.fields & schedule::FIELD_TRANSITION) && config.transition != rule.transition) {
+    config.transition = rule.transition;
+    changes |= webApi::CHANGE_TRANSITION;
+  }
+
+  return changes;
 }
 
 // ------------------------------------------------------------
@@ -1061,21 +1863,41 @@ void setPixels(time_t time, String *timeString) {
 // Display Task - Runs on Core 1 (default Arduino core)
 // Handles LED matrix updates and animations at high frequency
 void displayTask(void *parameter) {
-  static bool lastUpdate = false;
+  TickType_t lastWake = xTaskGetTickCount();
 
   for (;;) {
-    // Detect rising edge of update flag - only refresh once when settings change
-    bool settingsChanged = update && !lastUpdate;
-    lastUpdate = update;
+    bool scheduleRedraw = updateSchedule();
+
+    // Take the request before drawing, an edit made during a transition sets it again for the next tick
+    bool settingsChanged = __atomic_exchange_n(&update, false, __ATOMIC_ACQ_REL) || scheduleRedraw;
 
     refreshMatrix(settingsChanged);
 
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Animated colour modes redraw only the lit words, at a fixed frame rate
+    bool animating = config.enabled && currentStatus == STATUS_READY && config.colorMode != colorModes::MODE_STATIC;
+    if (animating) {
+      renderColorFrame();
+    }
+
+    publishFrame();  // Flush frames held back by the per-viewer rate limit
+
+    // Sleep for the rest of the frame on a fixed grid, this task runs on core 1 and leaves the rest to WiFi and the webserver
+    TickType_t period = pdMS_TO_TICKS(animating ? COLOR_FRAME_MS : 100);
+    TickType_t elapsed = xTaskGetTickCount() - lastWake;
+    if (elapsed >= period) {
+      lastWake += elapsed;  // Overran, e.g. a transition: restart the grid instead of catching up with a burst of frames
+      elapsed = 0;
+    }
+
+    // Wake up right at the minute boundary so synced clocks flip together
+    int64_t wake = clockSync::wakeDelay(clockMicros(), announcedTransition(), (int64_t)(period - elapsed) * portTICK_PERIOD_MS * 1000);
+    vTaskDelayUntil(&lastWake, elapsed + pdMS_TO_TICKS(wake / 1000));
   }
 }
 
 void networkTask(void *parameter) {
-  currentStatus = STATUS_WIFI;
+  setStatus(STATUS_WIFI);
+  unsigned long phaseStart = millis();
 
   if (!wm.autoConnect(AP_SSID)) {
     serialPrintln(F("Failed to connect to WiFi"));
@@ -1088,13 +1910,20 @@ void networkTask(void *parameter) {
   }
 
   wifiConnected = true;
-  currentStatus = STATUS_NTP;  // Now waiting for NTP
+  recordBootPhase(BOOT_WIFI, phaseStart);
+  setStatus(STATUS_NTP);  // Now waiting for NTP
   onWiFiConnected();
 
   // Main network task loop
   for (;;) {
     checkWiFiConnection();
     updateTime();
+    updateClockSync();
+
+    if (settingsBroadcastPending) {
+      settingsBroadcastPending = false;
+      broadcastSettings();
+    }
 
     vTaskDelay(pdMS_TO_TICKS(1000));  // Run every second
   }